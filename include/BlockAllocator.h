@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <memory>
 #include <type_traits>
 #include <cstddef>
@@ -16,7 +17,8 @@ public:
     }
 
     virtual ~BlockAllocator() {
-        // TODO: free cache_table
+        release_caches();
+        delete [] this->cache_tables;
     }
 
     T* take(const std::size_t num_blocks) {
@@ -38,6 +40,23 @@ public:
         set_list_head(pkt->num_blocks, pkt);
     }
 
+    /**
+     * Deletes all the cached blocks.
+     *
+     * The blocks in use are not affected. They are cached again when they are freed.
+     */
+    void release_caches() {
+        for (std::size_t i = 0; i < this->cache_table_size; i++) {
+            BlockPacket* pkt = this->cache_tables[i];
+            while (pkt != nullptr) {
+                BlockPacket* next = pkt->next;
+                delete [] reinterpret_cast<uint8_t *>(pkt);
+                pkt = next;
+            }
+            this->cache_tables[i] = nullptr;
+        }
+    }
+
 private:
     struct BlockPacket {
         BlockPacket *next;
@@ -67,9 +86,15 @@ private:
         this->cache_tables[idx] = pkt;
     }
 
+    // The table is at least doubled so that it is rarely resized for growing sizes.
     void resize_cache_table(const std::size_t num_tables) {
-        // TODO: implement
-        assert(false);
+        const std::size_t new_size = std::max(num_tables, 2 * this->cache_table_size);
+        BlockPacket** new_tables = new BlockPacket*[new_size];
+        for (std::size_t i = 0; i < new_size; i++)
+            new_tables[i] = (i < this->cache_table_size) ? this->cache_tables[i] : nullptr;
+        delete [] this->cache_tables;
+        this->cache_tables = new_tables;
+        this->cache_table_size = new_size;
     }
 
     BlockPacket* create_BlockPacket(const std::size_t num_blocks) {
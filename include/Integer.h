@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <string>
@@ -13,6 +14,12 @@ public:
     using block_t = uint64_t;
     static constexpr int BlockBits = sizeof(Integer::block_t) * 8;
 
+    /**
+     * The number of blocks stored in the object itself. An Integer with more blocks takes
+     * them from the allocator.
+     */
+    static constexpr std::size_t NumInlineBlocks = 2;
+
     /**
      * Copy constructor
      *
@@ -26,12 +33,15 @@ public:
     /**
      * Move constructor
      *
+     * The blocks from the allocator are moved. The inline blocks are copied, and `n`
+     * keeps its value.
+     *
      * @param n An Integer instance.
      */
     Integer(Integer&& n)
     : num_blocks(n.num_blocks),
-      blocks(n.blocks) {
-        n.blocks = nullptr;
+      capacity(n.capacity) {
+        take_blocks(n);
     }
 
     /**
@@ -46,12 +56,34 @@ public:
             blocks[idx--] = v;
     }
 
+    /**
+     * Creates an Integer from blocks.
+     *
+     * @param blocks The blocks. Least significant block first.
+     * @param num_blocks The number of blocks. It must be greater than 0.
+     * @return The created Integer that has num_blocks blocks.
+     */
+    static Integer from_blocks(const block_t* blocks, const std::size_t num_blocks) {
+        return from_blocks(blocks, num_blocks, num_blocks);
+    }
+
+    /**
+     * Creates an Integer of the given number of blocks from blocks.
+     *
+     * @param blocks The blocks. Least significant block first.
+     * @param num_blocks The number of `blocks`.
+     * @param n The number of blocks of the created Integer. It must be greater than 0.
+     *          The blocks over num_blocks are zero, and `blocks` over n are dropped.
+     * @return The created Integer.
+     */
+    static Integer from_blocks(const block_t* blocks, const std::size_t num_blocks,
+                               const std::size_t n);
+
     /**
      * Destructor
      */
     virtual ~Integer() {
-        if (this->blocks != nullptr)
-            this->allocator->free(this->blocks);
+        free_blocks();
     }
 
     /**
@@ -63,6 +95,27 @@ public:
         return this->num_blocks;
     }
 
+    /**
+     * Returns the number of blocks that can be used without a reallocation.
+     *
+     * @return The number of blocks of the storage. It is not less than get_num_blocks().
+     */
+    std::size_t get_capacity() const {
+        return this->capacity;
+    }
+
+    /**
+     * Enlarges the storage. The value and the number of blocks are not changed.
+     *
+     * @param n The number of blocks. Nothing is done if it is not greater than the capacity.
+     */
+    void reserve(const std::size_t n);
+
+    /**
+     * Shrinks the storage to the number of blocks, or to the inline blocks if they are enough.
+     */
+    void shrink_to_fit();
+
     /**
      * Returns the internal blocks.
      *
@@ -78,6 +131,9 @@ public:
     /**
      * Adds the given Integer value to this.
      *
+     * The compound assignments calculate in the storage of this Integer, which is
+     * reallocated only when the result needs more blocks than the capacity.
+     *
      * @param n A right-hand side Integer value.
      * @return This Integer value which is a sum result.
      */
@@ -175,6 +231,17 @@ public:
     Integer& set_bit_value(const int b, const bool v);
 
     Integer pow(const Integer& e) const;
+
+    /**
+     * Calculates this^e mod mod.
+     *
+     * The precomputed values of the modulus are reused through ModContextCache.
+     * A modulus that fits in a block uses the native 64-bit kernels of gear instead.
+     *
+     * @param e An exponent.
+     * @param mod A modulus.
+     * @return The result.
+     */
     Integer pow_mod(const Integer& e, const Integer& mod) const;
 
     /**
@@ -213,6 +280,15 @@ public:
         return !is_odd();
     }
 
+    /**
+     * Returns whether the value fits in the least significant block.
+     *
+     * @return true if all the other blocks are zero. Otherwise false.
+     */
+    bool fits_in_block() const {
+        return gear::is_all_zero(this->blocks + 1, this->num_blocks - 1);
+    }
+
     /**
      * Returns whether the value is zero.
      *
@@ -233,7 +309,9 @@ protected:
      */
     Integer(const std::size_t n_blk)
     : num_blocks(n_blk),
-      blocks(get_allocator()->take(this->num_blocks)) {
+      capacity(std::max(n_blk, NumInlineBlocks)),
+      blocks((n_blk <= NumInlineBlocks) ? this->inline_blocks
+                                        : get_allocator()->take(this->num_blocks)) {
     }
 
     /**
@@ -251,15 +329,43 @@ private:
     static __thread BlockAllocator<block_t> *allocator;
 
     std::size_t num_blocks;
-    block_t* blocks; // Least significant block first
+    std::size_t capacity;
+    block_t* blocks; // Least significant block first. It points inline_blocks or the allocator's.
+    block_t inline_blocks[NumInlineBlocks];
 
     inline BlockAllocator<block_t> *get_allocator() {
         // Don't delete 'allocator' because allocator::free() may be called after its destruction
         // due to the destructor of static Integer objects.
         if (this->allocator == nullptr)
-            this->allocator = new BlockAllocator<block_t>;
+            create_allocator();
         return allocator;
     }
+
+    static void create_allocator();
+
+    bool is_inline() const {
+        return this->blocks == this->inline_blocks;
+    }
+
+    void free_blocks() {
+        if (this->blocks != nullptr && !is_inline())
+            get_allocator()->free(this->blocks);
+    }
+
+    void resize(const std::size_t n);
+    void trim();
+    void assign_blocks(const block_t* src, const std::size_t n);
+
+    // num_blocks and capacity must be set to those of n beforehand.
+    void take_blocks(Integer& n) {
+        if (n.is_inline()) {
+            this->blocks = this->inline_blocks;
+            gear::copy(this->blocks, n.blocks, this->num_blocks);
+        } else {
+            this->blocks = n.blocks;
+            n.blocks = nullptr;
+        }
+    }
 };
 
 } // namespace grill
@@ -0,0 +1,132 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "rsa.h"
+
+namespace grill {
+namespace rsa {
+
+/**
+ * Keys generated in advance by background threads.
+ *
+ * A queue of keys is kept for each bit length. The workers refill the queue with the
+ * lowest ratio of the keys to the capacity first. They run with the idle scheduling
+ * policy where it is available, so they use only the CPU time left by other threads.
+ * An exception thrown while generating keys is kept in the queue and rethrown by the
+ * next take() or try_take() of the bit length. The queue is not refilled until then.
+ */
+class KeyPool {
+public:
+    struct Spec {
+        /**
+         * The bit length of the keys.
+         */
+        std::size_t bit_length;
+
+        /**
+         * The number of the keys kept ready.
+         */
+        std::size_t capacity;
+
+        /**
+         * The number of the primes of a key.
+         */
+        std::size_t num_primes = 2;
+    };
+
+    struct Metrics {
+        std::size_t depth = 0;         // The number of the ready keys
+        std::size_t capacity = 0;
+        std::size_t num_generated = 0;
+        std::size_t num_taken = 0;
+        std::size_t num_waits = 0;     // The number of take() that waited for a key
+        double refill_rate = 0;        // Generated keys per second since the construction
+    };
+
+    /**
+     * Constructor
+     *
+     * The workers start to fill the pool immediately.
+     *
+     * @param specs The bit lengths and the capacities. Each bit length must be unique.
+     * @param num_threads The number of the background threads. 0 means the number of
+     *                    the hardware threads.
+     * @throw std::invalid_argument A bit length is duplicated, a capacity is 0, or
+     *                              a spec doesn't pass check_key_size().
+     */
+    explicit KeyPool(const std::vector<Spec>& specs, const std::size_t num_threads = 1);
+
+    /**
+     * Destructor
+     *
+     * The keys being generated are finished before the workers are joined.
+     */
+    virtual ~KeyPool();
+
+    KeyPool(const KeyPool&) = delete;
+    KeyPool& operator=(const KeyPool&) = delete;
+
+    /**
+     * Take keys. It waits until keys are generated if the pool is empty.
+     *
+     * @param bit_length The bit length of the keys.
+     * @return The keys.
+     * @throw std::invalid_argument The bit length is not in the specs.
+     * @throw std::runtime_error The pool is destroyed while waiting.
+     * @throw Any exception thrown by generate_keys() for the bit length.
+     */
+    Keys take(const std::size_t bit_length);
+
+    /**
+     * Take keys without waiting.
+     *
+     * @param bit_length The bit length of the keys.
+     * @return The keys. No value is returned if the pool is empty.
+     * @throw std::invalid_argument The bit length is not in the specs.
+     * @throw Any exception thrown by generate_keys() for the bit length.
+     */
+    std::optional<Keys> try_take(const std::size_t bit_length);
+
+    /**
+     * @param bit_length The bit length of the keys.
+     * @return The metrics of the keys.
+     * @throw std::invalid_argument The bit length is not in the specs.
+     */
+    Metrics get_metrics(const std::size_t bit_length) const;
+
+private:
+    struct Slot {
+        Spec spec;
+        std::deque<Keys> keys;
+        std::size_t num_generating = 0;
+        std::size_t num_generated = 0;
+        std::size_t num_taken = 0;
+        std::size_t num_waits = 0;
+        std::exception_ptr error; // Thrown by generate_keys() and not reported yet
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable refill_cond;
+    std::condition_variable ready_cond;
+    bool stopping = false;
+    std::map<std::size_t, Slot> slots;
+    const std::chrono::steady_clock::time_point start_time;
+    std::vector<std::thread> workers;
+
+    Slot& get_slot(const std::size_t bit_length);
+    const Slot& get_slot(const std::size_t bit_length) const;
+    Slot* find_slot_to_refill();
+    Keys pop_keys(Slot& slot, std::unique_lock<std::mutex>& lock);
+    void work();
+};
+
+} // namespace rsa
+} // namespace grill
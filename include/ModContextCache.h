@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "ModInteger.h"
+
+namespace grill {
+
+/**
+ * A process-wide LRU cache of modular arithmetic contexts.
+ *
+ * The contexts are looked up by the hash of the modulus blocks. All methods are thread safe.
+ */
+class ModContextCache {
+public:
+    static constexpr std::size_t DefaultCapacity = 32;
+
+    /**
+     * Returns the process-wide instance.
+     *
+     * @return The instance.
+     */
+    static ModContextCache& get_instance();
+
+    /**
+     * Returns the context of the given modulus.
+     *
+     * The context is created and stored when it isn't in the cache.
+     *
+     * @param modulus A modulus.
+     * @return The context.
+     */
+    std::shared_ptr<const ModContext> get(const Integer& modulus);
+
+    /**
+     * Sets the maximum number of the cached contexts.
+     *
+     * The least recently used contexts are evicted when the cache has more contexts.
+     * Zero disables the cache.
+     *
+     * @param capacity The maximum number of the cached contexts.
+     */
+    void set_capacity(const std::size_t capacity);
+
+    std::size_t get_capacity() const;
+    std::size_t get_size() const;
+    std::size_t get_num_hits() const;
+    std::size_t get_num_misses() const;
+
+    /**
+     * Removes all contexts and resets the counters.
+     */
+    void clear();
+
+private:
+    using ContextList = std::list<std::shared_ptr<const ModContext>>;
+
+    mutable std::mutex mutex;
+    std::size_t capacity = DefaultCapacity;
+    std::size_t num_hits = 0;
+    std::size_t num_misses = 0;
+    ContextList contexts; // The most recently used first
+    std::unordered_map<std::size_t, ContextList::iterator> context_map;
+
+    void evict(const std::size_t max_size);
+};
+
+} // namespace grill
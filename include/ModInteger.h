@@ -0,0 +1,267 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "Integer.h"
+
+namespace grill {
+
+/**
+ * A context of modular arithmetic.
+ *
+ * It holds the values precomputed from the modulus. An odd modulus uses Montgomery
+ * representation unless Barrett reduction is chosen, and an even modulus uses Barrett
+ * reduction. Residues handled by the following methods are blocks in the internal
+ * representation and have get_num_blocks() blocks.
+ *
+ * pow() of an odd modulus with at least Limb52MinBits bits is calculated in 52-bit
+ * limbs by AVX-512 IFMA when the CPU supports it.
+ */
+class ModContext {
+public:
+    using block_t = Integer::block_t;
+    static constexpr block_t SmallBaseLimit = 32;
+    static constexpr int Limb52MinBits = 256;
+
+    /**
+     * The values for gear::montgomery_mul52() of the modulus.
+     */
+    struct Limbs52 {
+        std::size_t num = 0;     // The number of limbs, where R = 2^(52*num) and 4 * modulus < R
+        std::vector<block_t> n;  // The limbs of the modulus
+        std::vector<block_t> r2; // The limbs of R^2 mod modulus
+        block_t n0inv = 0;       // -modulus^-1 mod 2^52
+    };
+
+    enum class Reduction {
+        Auto,    // Montgomery representation for an odd modulus, otherwise Barrett reduction
+        Barrett, // Barrett reduction for any modulus
+    };
+
+    /**
+     * Constructor
+     *
+     * @param modulus A modulus. It must not be zero.
+     * @param reduction The reduction method. Reduction::Barrett is needed by divide().
+     */
+    explicit ModContext(const Integer& modulus, const Reduction reduction = Reduction::Auto);
+
+    /**
+     * Returns the modulus.
+     *
+     * @return The modulus.
+     */
+    const Integer& get_modulus() const {
+        return this->modulus;
+    }
+
+    /**
+     * Returns the number of blocks of the residues in this context.
+     *
+     * @return The number of blocks.
+     */
+    std::size_t get_num_blocks() const {
+        return this->num_blocks;
+    }
+
+    /**
+     * Returns whether Montgomery representation is used.
+     *
+     * @return true if the modulus is odd. Otherwise false.
+     */
+    bool is_montgomery() const {
+        return this->montgomery;
+    }
+
+    /**
+     * Returns the values for the 52-bit limbs, which pow() uses.
+     *
+     * @return The values, or nullptr if pow() doesn't use 52-bit limbs.
+     */
+    const Limbs52* get_limbs52() const {
+        return (this->limbs52.num > 0) ? &this->limbs52 : nullptr;
+    }
+
+    /**
+     * Calculates base^e mod modulus.
+     *
+     * A base less than SmallBaseLimit such as 2 takes a faster path
+     * that multiplies by shifts and additions.
+     *
+     * @param base A base.
+     * @param e An exponent.
+     * @return The result.
+     */
+    Integer pow(const Integer& base, const Integer& e) const;
+
+    /**
+     * Converts an Integer to the internal representation.
+     *
+     * @param out The output buffer.
+     * @param n An Integer. It is reduced by reduce() when it is not less than the modulus.
+     */
+    void to_internal(block_t* out, const Integer& n) const;
+
+    /**
+     * Calculates n mod modulus without a long division.
+     *
+     * n is reduced by the Montgomery multiplication or the Barrett reduction of this
+     * context, a few multiplications for each get_num_blocks() blocks of n.
+     *
+     * @param out The output buffer. The result is a normal number, not in the internal
+     *            representation.
+     * @param n An Integer of any size.
+     */
+    void reduce(block_t* out, const Integer& n) const;
+
+    /**
+     * Divides x by the modulus with Barrett reduction.
+     *
+     * Only the upper blocks of the precomputed reciprocal are used for a short x, so the
+     * cost depends on the length of x.
+     *
+     * @param q The output buffer of the quotient. It has max(1, num_x - get_num_blocks() + 1)
+     *          blocks.
+     * @param r The output buffer of the remainder. It has get_num_blocks() blocks.
+     * @param x A dividend.
+     * @param num_x The number of blocks of x. It must not be greater than
+     *              2 * get_num_blocks().
+     * @throw std::invalid_argument The context uses Montgomery representation or x is too
+     *                              long.
+     */
+    void divide(block_t* q, block_t* r, const block_t* x, const std::size_t num_x) const;
+
+    /**
+     * Converts a residue in the internal representation to an Integer.
+     *
+     * @param in A residue.
+     * @return The converted Integer.
+     */
+    Integer to_Integer(const block_t* in) const;
+
+    void set_one(block_t* out) const;
+    void add(block_t* out, const block_t* a, const block_t* b) const;
+    void sub(block_t* out, const block_t* a, const block_t* b) const;
+    void mul(block_t* out, const block_t* a, const block_t* b) const;
+    void square(block_t* out, const block_t* a) const;
+    void halve(block_t* out, const block_t* a) const;
+    void pow(block_t* out, const block_t* base, const Integer& e) const;
+    void pow(block_t* out, const Integer& base, const Integer& e) const;
+
+private:
+    Integer modulus;
+    std::size_t num_blocks;
+    bool montgomery;
+
+    // Montgomery representation
+    block_t n0inv = 0;
+    Integer r1; // R mod modulus, where R = 2^(64*num_blocks)
+    Integer r2; // R^2 mod modulus
+
+    // Barrett reduction
+    Integer mu; // floor(R^2 / modulus) or a value less than it by a few
+
+    // Radix 2^52 for pow(). limbs52.num is 0 when it is not used.
+    Limbs52 limbs52;
+
+    bool can_reduce_lazily() const;
+    bool is_small_base(const Integer& base) const;
+    void mul_small(block_t* r, const block_t b) const;
+    void pow_small_base(block_t* out, const block_t base, const Integer& e) const;
+    void pow52(block_t* out, const block_t* base, const Integer& e) const;
+    void barrett_reduce(block_t* out, const block_t* x, const std::size_t num_x,
+                        block_t* q = nullptr) const;
+    void reduce_to_internal(block_t* out, const Integer& n) const;
+};
+
+/**
+ * An Integer value bound to a modular arithmetic context.
+ *
+ * The value is kept reduced in the internal representation of the context,
+ * so a chain of operations doesn't need any division.
+ */
+class ModInteger {
+public:
+    using block_t = Integer::block_t;
+
+    /**
+     * Constructor
+     *
+     * @param n An initial value. It is reduced by the modulus of the context.
+     * @param context A modular arithmetic context.
+     */
+    ModInteger(const Integer& n, const std::shared_ptr<const ModContext>& context);
+
+    ModInteger(const ModInteger& n) = default;
+    ModInteger(ModInteger&& n) = default;
+    ModInteger& operator=(const ModInteger& n);
+    ModInteger& operator=(ModInteger&& n) = default;
+
+    /**
+     * Returns the context.
+     *
+     * @return The context this value is bound to.
+     */
+    const std::shared_ptr<const ModContext>& get_context() const {
+        return this->context;
+    }
+
+    /**
+     * Returns the value as an Integer.
+     *
+     * @return The value less than the modulus.
+     */
+    Integer to_Integer() const;
+
+    friend std::ostream& operator<<(std::ostream& os, const ModInteger& n);
+
+    ModInteger operator+(const ModInteger& r) const;
+    ModInteger operator-(const ModInteger& r) const;
+    ModInteger operator*(const ModInteger& r) const;
+    ModInteger& operator+=(const ModInteger& r);
+    ModInteger& operator-=(const ModInteger& r);
+    ModInteger& operator*=(const ModInteger& r);
+
+    bool operator==(const ModInteger& r) const;
+    bool operator!=(const ModInteger& r) const;
+
+    ModInteger square() const;
+
+    /**
+     * Calculates this / 2 modulo an odd modulus.
+     *
+     * @return The result.
+     */
+    ModInteger halve() const;
+    ModInteger pow(const Integer& e) const;
+
+    /**
+     * Calculates base^e in the given context.
+     *
+     * Unlike ModInteger(base, context).pow(e), a small base takes the faster path
+     * of ModContext::pow().
+     *
+     * @param base A base.
+     * @param e An exponent.
+     * @param context A modular arithmetic context.
+     * @return The result.
+     */
+    static ModInteger pow(const Integer& base, const Integer& e,
+                          const std::shared_ptr<const ModContext>& context);
+
+    /**
+     * Calculates the inverse number.
+     *
+     * @return The inverse number modulo the modulus of the context.
+     */
+    ModInteger inverse() const;
+
+private:
+    std::shared_ptr<const ModContext> context;
+    Integer value; // The internal representation of the context
+
+    ModInteger(const block_t* blocks, const std::shared_ptr<const ModContext>& context);
+    // The contexts must have the same modulus and representation.
+    void check_context(const ModInteger& r) const;
+};
+
+} // namespace grill
@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+#include "Integer.h"
+
+namespace grill {
+
+/**
+ * A segmented sieve of Eratosthenes that enumerates the primes in a range.
+ *
+ * Only odd numbers are held in a segment, and the multiples of 3, 5 and 7 are
+ * removed at once by copying a precomputed wheel pattern. The other primes are
+ * sieved segment by segment, so the memory usage doesn't depend on the length
+ * of the range. An instance supports one iteration at a time.
+ */
+class PrimeSieve {
+public:
+    using block_t = Integer::block_t;
+
+    /**
+     * The number of odd numbers in a segment. A segment fits in L1 cache.
+     */
+    static constexpr std::size_t SegmentSize = 32 * 1024;
+
+    /**
+     * The upper bound of the process-wide table of small primes. The table takes
+     * about 8.6 MB at most. A sieve over the square of this value sieves the rest
+     * of its sieving primes by itself.
+     */
+    static constexpr block_t SmallPrimeTableLimit = 1 << 24;
+
+    /**
+     * An input iterator over the primes.
+     */
+    class iterator {
+    public:
+        block_t operator*() const {
+            return this->value;
+        }
+
+        iterator& operator++() {
+            this->next();
+            return *this;
+        }
+
+        bool operator==(const iterator& r) const {
+            return this->sieve == r.sieve;
+        }
+
+        bool operator!=(const iterator& r) const {
+            return !(*this == r);
+        }
+
+    private:
+        friend class PrimeSieve;
+
+        PrimeSieve* sieve; // nullptr at the end
+        block_t value = 0;
+
+        iterator(PrimeSieve* sieve);
+        void next();
+    };
+
+    /**
+     * Constructor
+     *
+     * @param from The lower bound of the range (inclusive).
+     * @param to The upper bound of the range (exclusive).
+     */
+    PrimeSieve(const block_t from, const block_t to);
+
+    /**
+     * Starts the iteration from the lower bound.
+     *
+     * @return An iterator at the first prime.
+     */
+    iterator begin();
+
+    iterator end();
+
+    /**
+     * Returns the next prime.
+     *
+     * @return The next prime. No value is returned at the end of the range.
+     */
+    std::optional<block_t> next();
+
+    /**
+     * Returns all the primes in a range.
+     *
+     * @param from The lower bound of the range (inclusive).
+     * @param to The upper bound of the range (exclusive).
+     * @return The primes in ascending order.
+     */
+    static std::vector<block_t> get_primes(const block_t from, const block_t to);
+
+    /**
+     * Returns the process-wide table of small primes.
+     *
+     * The table is extended in place when it doesn't cover the limit. It is never
+     * moved or shrunk, so the returned span can be used without any lock.
+     *
+     * @param limit The table has all the primes less than this value at least.
+     * @return The primes in ascending order.
+     * @throw std::invalid_argument limit is over SmallPrimeTableLimit.
+     */
+    static std::span<const block_t> get_small_primes(const block_t limit);
+
+private:
+    block_t from;
+    block_t to;
+
+    // The current segment has the odd numbers low, low + 2, ..., low + 2 * (size - 1).
+    block_t low = 0;
+    block_t next_low = 0;
+    std::size_t size = 0;
+    std::size_t pos = 0;
+    std::size_t word_pos = 0;
+    uint64_t word_mask = 0; // The primes in the 8 flags from word_pos
+    bool two_pending = false;
+    bool last_segment = false;
+    std::vector<uint8_t> composite; // Padded to be read by 8 bytes
+    std::vector<block_t> own_sieving_primes; // Used only when the table doesn't suffice
+    block_t own_sieving_limit = 0;
+    std::vector<std::size_t> next_offsets; // The next index to be marked for each sieving prime
+
+    void restart();
+    void fill_segment(const block_t seg_low);
+    std::span<const block_t> get_sieving_primes(const block_t limit);
+};
+
+} // namespace grill
@@ -0,0 +1,92 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace grill {
+
+/**
+ * A fixed number of worker threads that run submitted tasks.
+ *
+ * The workers live as long as the pool, so the per-thread block allocators of
+ * Integer are reused by the tasks instead of being created for each task.
+ */
+class ThreadPool {
+public:
+    /**
+     * Constructor
+     *
+     * @param num_threads The number of worker threads. 0 means the number of
+     *                    the hardware threads.
+     */
+    explicit ThreadPool(const std::size_t num_threads = 0);
+
+    /**
+     * Destructor
+     *
+     * The queued tasks are finished before the workers are joined.
+     */
+    virtual ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t get_num_threads() const {
+        return this->workers.size();
+    }
+
+    /**
+     * Queue a task.
+     *
+     * @param f A function called by a worker.
+     * @return A future for the return value of f. An exception from f is thrown by
+     *         its get().
+     */
+    template<typename F>
+    auto submit(F&& f) -> std::future<decltype(f())> {
+        using R = decltype(f());
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> future = task->get_future();
+        this->push([task] {
+            (*task)();
+        });
+        return future;
+    }
+
+    /**
+     * Call f(0), f(1), ..., f(n - 1) on the workers and wait for all of them.
+     *
+     * It must not be called from a task of the same pool, which would wait for itself.
+     *
+     * @param n The number of calls.
+     * @param f A function called with an index.
+     * @throw The first exception thrown by f after all the calls are finished.
+     */
+    void run(const std::size_t n, const std::function<void(const std::size_t)>& f);
+
+    /**
+     * Returns the number of threads for a request.
+     *
+     * @param num_threads The requested number. 0 means the number of the hardware threads.
+     * @return num_threads if it is not 0. Otherwise the number of the hardware threads.
+     */
+    static std::size_t resolve_num_threads(const std::size_t num_threads);
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool stopping = false;
+
+    void push(std::function<void()>&& task);
+    void work();
+};
+
+} // namespace grill
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Integer.h"
+
+namespace grill {
+namespace batch_gcd {
+
+/**
+ * A product tree. The first level has the leaves and the last level has only the root.
+ * Each node is the product of its two children. The last node of a level with an odd
+ * number of nodes is carried up as it is.
+ */
+using ProductTree = std::vector<std::vector<Integer>>;
+
+/**
+ * The default number of moduli in a group.
+ *
+ * The root of a group is about 2M bits for 2048-bit moduli. The tree nodes are
+ * multiplied with buffers on the stack, so a much larger group may overflow the stack.
+ */
+constexpr std::size_t DefaultGroupSize = 1024;
+
+struct Options {
+    /**
+     * The number of threads. 0 means the number of the hardware threads.
+     */
+    std::size_t num_threads = 0;
+
+    /**
+     * The number of moduli in a group. A product tree is built for each group.
+     */
+    std::size_t group_size = DefaultGroupSize;
+
+    /**
+     * A directory to store the product trees. If it is not empty, the trees are
+     * written in the directory and only one tree at a time is loaded in memory.
+     * The files are removed at the end.
+     */
+    std::string work_dir;
+};
+
+/**
+ * Build a product tree.
+ *
+ * The nodes of a level are calculated in parallel.
+ *
+ * @param leaves Non-zero Integers.
+ * @param num_threads The number of threads. 0 means the number of the hardware threads.
+ * @return The product tree.
+ */
+ProductTree build_product_tree(const std::vector<Integer>& leaves,
+                               const std::size_t num_threads = 1);
+
+/**
+ * Calculate the remainders of x modulo the square of each leaf by a remainder tree.
+ *
+ * A scaled remainder tree is used: x is divided by the square of the root, and the
+ * fractional part of the quotient is passed down to the leaves by multiplications.
+ * The nodes of a level are calculated in parallel.
+ *
+ * @param x An Integer.
+ * @param tree A product tree.
+ * @param num_threads The number of threads. 0 means the number of the hardware threads.
+ * @return x mod leaf^2 for each leaf in the same order.
+ */
+std::vector<Integer> calc_remainders(const Integer& x, const ProductTree& tree,
+                                     const std::size_t num_threads = 1);
+
+/**
+ * Calculate the gcd of each modulus and the product of the others.
+ *
+ * The moduli are divided into groups. Let R_j be the root of the product tree of group j.
+ * The product of all the moduli modulo R_i^2 is calculated from the roots, and it is
+ * reduced by the remainder tree of group i. The gcd for a modulus N is
+ * gcd((P mod N^2) / N, N), where P is the product of all the moduli.
+ *
+ * @param moduli Non-zero Integers.
+ * @param options Options.
+ * @return The gcds in the same order as the moduli. A result other than one means that
+ *         the modulus shares a factor with another modulus.
+ */
+std::vector<Integer> calc(const std::vector<Integer>& moduli, const Options& options = Options());
+
+} // namespace batch_gcd
+} // namespace grill
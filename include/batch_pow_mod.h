@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "Integer.h"
+#include "ModInteger.h"
+
+namespace grill {
+namespace batch_pow_mod {
+
+/**
+ * The number of the exponentiations advanced in lockstep.
+ */
+constexpr std::size_t NumLanes = 8;
+
+enum class Backend {
+    Scalar,     // ModContext::pow() for each exponentiation
+    Avx512Ifma, // NumLanes exponentiations in the lanes of 52-bit limbs
+};
+
+/**
+ * Returns the fastest backend on this CPU.
+ *
+ * @return Backend::Avx512Ifma if the CPU has AVX-512 IFMA. Otherwise Backend::Scalar.
+ */
+Backend get_backend();
+
+/**
+ * Calculate bases[i]^exponents[i] mod moduli[i] for each i.
+ *
+ * `exponents` and `moduli` may have only one element, which is used for all the bases.
+ *
+ * With Backend::Avx512Ifma, the exponentiations are grouped by the size of the modulus,
+ * and each group of NumLanes exponentiations is calculated by the fixed window method in
+ * lockstep. An element of a vector register holds a 52-bit limb of each exponentiation,
+ * and the lanes can have different moduli and exponents. A ModContext is created for each
+ * run of the same modulus. A modulus whose context doesn't have the 52-bit limbs
+ * (see ModContext::get_limbs52()) is calculated by ModContext::pow().
+ *
+ * @param bases Bases.
+ * @param exponents Exponents.
+ * @param moduli Odd moduli greater than one.
+ * @param backend A backend. Backend::Avx512Ifma must be supported by the CPU.
+ * @return The results in the order of the bases.
+ * @throw std::invalid_argument The sizes of `exponents` or `moduli` don't match `bases`,
+ *                              or a modulus is even or one.
+ */
+std::vector<Integer> calc(std::span<const Integer> bases, std::span<const Integer> exponents,
+                          std::span<const Integer> moduli, const Backend backend = get_backend());
+
+/**
+ * Calculate bases[i]^exponents[i] mod the modulus of the context for each i.
+ *
+ * The limbs of the modulus and R^2 are taken from the context instead of being calculated
+ * for each call, so the context should be kept for the repeated calls with a modulus.
+ *
+ * @param bases Bases.
+ * @param exponents Exponents. It may have only one element, which is used for all the bases.
+ * @param context A context of an odd modulus greater than one.
+ * @param backend A backend. Backend::Avx512Ifma must be supported by the CPU.
+ * @return The results in the order of the bases.
+ * @throw std::invalid_argument The size of `exponents` doesn't match `bases`, or the
+ *                              modulus is even or one.
+ */
+std::vector<Integer> calc(std::span<const Integer> bases, std::span<const Integer> exponents,
+                          const ModContext& context, const Backend backend = get_backend());
+
+} // namespace batch_pow_mod
+} // namespace grill
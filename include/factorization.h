@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <vector>
+#include "Integer.h"
+
+namespace grill {
+namespace factorization {
+
+/**
+ * The default number of the rho iterations whose differences are multiplied
+ * before one gcd is calculated.
+ */
+constexpr std::size_t DefaultBatchSize = 128;
+
+struct Options {
+    /**
+     * The number of threads that run independent random seeds. 0 means the number
+     * of the hardware threads.
+     */
+    std::size_t num_threads = 0;
+
+    /**
+     * The number of the iterations for a gcd.
+     */
+    std::size_t batch_size = DefaultBatchSize;
+
+    /**
+     * The maximum number of the iterations for a seed. 0 means no limit.
+     */
+    std::size_t max_iterations = 0;
+
+    /**
+     * The maximum number of seeds for a thread. 0 means no limit.
+     */
+    std::size_t max_seeds = 0;
+};
+
+/**
+ * Find a factor by Pollard's rho method with Brent's cycle detection.
+ *
+ * The sequence x -> x^2 R^-1 + c (mod n) is calculated by Montgomery multiplication,
+ * where R = 2^(64*k) and k is the number of the blocks of n. The differences are
+ * multiplied and one gcd is calculated for a batch of iterations. Each thread runs
+ * independent random seeds, and all the threads stop at the first factor.
+ *
+ * @param n An odd composite Integer.
+ * @param options Options.
+ * @return A non-trivial factor of n. No value is returned when the limits are reached.
+ * @throw std::invalid_argument n is even, one or a probable prime by primality::bpsw_test(),
+ *                              or batch_size is 0.
+ */
+std::optional<Integer> pollard_brent(const Integer& n, const Options& options = Options());
+
+/**
+ * Factorize an Integer.
+ *
+ * The small factors are found by trial division with the small prime table.
+ * The rest is split by pollard_brent() until all the factors are primes.
+ * A factor is regarded as a prime when it passes the Baillie-PSW test.
+ *
+ * @param n A positive Integer.
+ * @param options Options. The limits are ignored.
+ * @return The prime factors in ascending order. A factor appears as many times as
+ *         its multiplicity. It is empty for one.
+ */
+std::vector<Integer> factorize(const Integer& n, const Options& options = Options());
+
+} // namespace factorization
+} // namespace grill
@@ -16,6 +16,22 @@ bool is_all_zero(const T* blocks, const std::size_t n) {
     return true;
 }
 
+/**
+ * Returns the number of blocks without the leading zero blocks.
+ *
+ * @tparam T A type of the block.
+ * @param blocks The blocks. Least significant block first.
+ * @param n The number of blocks.
+ * @return The number of blocks up to the most significant non-zero block. It is 1 when
+ *         all the blocks are zero.
+ */
+template<typename T>
+std::size_t get_num_active_blocks(const T* blocks, std::size_t n) {
+    while (n > 1 && blocks[n-1] == 0)
+        n--;
+    return n;
+}
+
 template<typename T>
 void copy(T* dest, const T* src, std::size_t n) {
     for (std::size_t i = 0; i < n; i++)
@@ -28,6 +44,24 @@ void fill_zero(T* dest, std::size_t n) {
         dest[i] = 0;
 }
 
+/**
+ * Compare two numbers that have the same number of blocks.
+ *
+ * @tparam T A type of the block.
+ * @param lhs The blocks of the left-hand side. Least significant block first.
+ * @param rhs The blocks of the right-hand side. Least significant block first.
+ * @param n The number of blocks of `lhs` and `rhs`.
+ * @return A positive value if lhs > rhs, a negative value if lhs < rhs. Otherwise 0.
+ */
+template<typename T>
+int compare(const T* lhs, const T* rhs, const std::size_t n) {
+    for (std::size_t i = n; i > 0; i--) {
+        if (lhs[i-1] != rhs[i-1])
+            return (lhs[i-1] > rhs[i-1]) ? 1 : -1;
+    }
+    return 0;
+}
+
 template<typename T>
 std::string to_string(const std::vector<T>& vect) {
     std::ostringstream oss;
@@ -134,6 +168,8 @@ void twos_complement(uint64_t* buf, const std::size_t num);
 /**
  * Calculate multiplication by Karatsuba method.
  *
+ * The schoolbook method is used when either number is small.
+ *
  * @param out The output buffer. Least significant block first.
  * @param n_out The number of blocks of `out`.
  * @param in0 The blocks to be multiplied. Least significant block first.
@@ -145,6 +181,326 @@ void karatsuba(uint64_t* out, const std::size_t n_out,
                const uint64_t* in0, const std::size_t num_in0,
                const uint64_t* in1, const std::size_t num_in1);
 
+/**
+ * Calculate the remainder of division by a single block.
+ *
+ * @param blocks The blocks to be divided. Least significant block first.
+ * @param num The number of blocks of `blocks`.
+ * @param d A divisor. It must not be zero.
+ * @return The remainder.
+ */
+uint64_t remainder(const uint64_t* blocks, const std::size_t num, const uint64_t d);
+
+/**
+ * Calculate -n0^-1 mod 2^64, which is used in Montgomery reduction.
+ *
+ * @param n0 The least significant block of an odd modulus.
+ * @return -n0^-1 mod 2^64.
+ */
+uint64_t montgomery_n0inv(const uint64_t n0);
+
+/**
+ * Calculate Montgomery multiplication: a * b * R^-1 mod n, where R = 2^(64*num).
+ *
+ * @param out The output buffer. It may be the same as `a` or `b`.
+ * @param a The blocks less than n. Least significant block first.
+ * @param b The blocks less than n. Least significant block first.
+ * @param n The blocks of an odd modulus. Least significant block first.
+ * @param num The number of blocks of `out`, `a`, `b` and `n`.
+ * @param n0inv The value returned from montgomery_n0inv(n[0]).
+ */
+void montgomery_mul(uint64_t* out, const uint64_t* a, const uint64_t* b,
+                    const uint64_t* n, const std::size_t num, const uint64_t n0inv);
+
+/**
+ * Calculate Montgomery multiplication without the final subtraction.
+ *
+ * The result is congruent to a * b * R^-1 modulo n and less than 2n.
+ * This can be chained as long as 4n < R, because `a` and `b` are allowed to be less than 2n.
+ *
+ * @param out The output buffer. It may be the same as `a` or `b`.
+ * @param a The blocks less than 2n. Least significant block first.
+ * @param b The blocks less than 2n. Least significant block first.
+ * @param n The blocks of an odd modulus. Least significant block first.
+ * @param num The number of blocks of `out`, `a`, `b` and `n`.
+ * @param n0inv The value returned from montgomery_n0inv(n[0]).
+ */
+void montgomery_mul_lazy(uint64_t* out, const uint64_t* a, const uint64_t* b,
+                         const uint64_t* n, const std::size_t num, const uint64_t n0inv);
+
+/**
+ * Calculate Montgomery squaring: a^2 * R^-1 mod n, where R = 2^(64*num).
+ *
+ * The cross products are calculated once, so it is faster than montgomery_mul(a, a).
+ *
+ * @param out The output buffer. It may be the same as `a`.
+ * @param a The blocks less than n. Least significant block first.
+ * @param n The blocks of an odd modulus. Least significant block first.
+ * @param num The number of blocks of `out`, `a` and `n`.
+ * @param n0inv The value returned from montgomery_n0inv(n[0]).
+ */
+void montgomery_sqr(uint64_t* out, const uint64_t* a,
+                    const uint64_t* n, const std::size_t num, const uint64_t n0inv);
+
+/**
+ * Calculate Montgomery squaring without the final subtraction.
+ *
+ * The same conditions as montgomery_mul_lazy() are applied.
+ *
+ * @param out The output buffer. It may be the same as `a`.
+ * @param a The blocks less than 2n. Least significant block first.
+ * @param n The blocks of an odd modulus. Least significant block first.
+ * @param num The number of blocks of `out`, `a` and `n`.
+ * @param n0inv The value returned from montgomery_n0inv(n[0]).
+ */
+void montgomery_sqr_lazy(uint64_t* out, const uint64_t* a,
+                         const uint64_t* n, const std::size_t num, const uint64_t n0inv);
+
+//
+// Radix 2^52
+//
+// A number is held in 52-bit limbs, least significant limb first, for the AVX-512 IFMA
+// instructions (vpmadd52luq/vpmadd52huq). The limbs are processed 8 at a time, so a buffer
+// of limbs has get_limb52_buffer_size() elements and the elements above the limbs are zero.
+//
+
+constexpr int Limb52Bits = 52;
+
+/**
+ * The maximum number of limbs of montgomery_mul52().
+ */
+constexpr std::size_t MaxNumLimbs52 = 128;
+
+/**
+ * Returns whether the CPU supports montgomery_mul52().
+ *
+ * @return true if the CPU has AVX-512 IFMA.
+ */
+bool is_ifma_supported();
+
+/**
+ * Returns the number of elements of a buffer of limbs.
+ *
+ * @param num The number of limbs.
+ * @return `num` rounded up to a multiple of 8.
+ */
+constexpr std::size_t get_limb52_buffer_size(const std::size_t num) {
+    return (num + 7) / 8 * 8;
+}
+
+/**
+ * Convert blocks to limbs.
+ *
+ * @param limbs The output buffer. The upper bits that don't fit in `num_limbs` are dropped.
+ * @param num_limbs The number of limbs to be written.
+ * @param blocks Blocks. Least significant block first.
+ * @param num_blocks The number of blocks of `blocks`.
+ * @param stride The distance between the limbs in `limbs`. The limbs of several numbers
+ *               can be interleaved with it.
+ */
+void to_limbs52(uint64_t* limbs, const std::size_t num_limbs,
+                const uint64_t* blocks, const std::size_t num_blocks,
+                const std::size_t stride = 1);
+
+/**
+ * Convert limbs to blocks.
+ *
+ * @param blocks The output buffer. The upper bits that don't fit in `num_blocks` are dropped.
+ * @param num_blocks The number of blocks to be written.
+ * @param limbs Limbs less than 2^52. Least significant limb first.
+ * @param num_limbs The number of limbs of `limbs`.
+ * @param stride The distance between the limbs in `limbs`.
+ */
+void from_limbs52(uint64_t* blocks, const std::size_t num_blocks,
+                  const uint64_t* limbs, const std::size_t num_limbs,
+                  const std::size_t stride = 1);
+
+/**
+ * Calculate Montgomery multiplication without the final subtraction by AVX-512 IFMA:
+ * a * b * R^-1 mod n, where R = 2^(52*num).
+ *
+ * The result is less than 2n and can be chained as long as 4n < R.
+ * The CPU must support it (see is_ifma_supported()).
+ *
+ * @param out The output buffer of limbs. It may be the same as `a` or `b`.
+ * @param a The limbs less than 2n.
+ * @param b The limbs less than 2n.
+ * @param n The limbs of an odd modulus.
+ * @param num The number of limbs. It must not be greater than MaxNumLimbs52.
+ * @param n0inv -n^-1 mod 2^52, which is the lower 52 bits of montgomery_n0inv().
+ */
+void montgomery_mul52(uint64_t* out, const uint64_t* a, const uint64_t* b,
+                      const uint64_t* n, const std::size_t num, const uint64_t n0inv);
+
+//
+// Fixed window method of exponentiation
+//
+
+/**
+ * Returns the window width for an exponent.
+ *
+ * @param exponent_bits The bit length of the exponent.
+ * @return The number of bits of a window.
+ */
+int choose_window_bits(const int exponent_bits);
+
+/**
+ * Returns the bits of an exponent in a window.
+ *
+ * @param e The blocks of an exponent. Least significant block first.
+ * @param num The number of blocks of `e`. The bits above them are zero.
+ * @param pos The position of the least significant bit of the window.
+ * @param width The number of bits of the window. It must be less than 32.
+ * @return The bits from `pos` to `pos + width - 1`.
+ */
+unsigned int get_window(const uint64_t* e, const std::size_t num, const int pos, const int width);
+
+/**
+ * Calculate a * b mod m.
+ *
+ * @param a A number.
+ * @param b An another number.
+ * @param m A modulus. It must not be zero.
+ * @return The result.
+ */
+uint64_t mul_mod(const uint64_t a, const uint64_t b, const uint64_t m);
+
+/**
+ * Calculate base^e mod m.
+ *
+ * Montgomery64 is used for an odd modulus.
+ *
+ * @param base A base.
+ * @param e The blocks of an exponent. Least significant block first.
+ * @param num The number of blocks of `e`.
+ * @param m A modulus. It must not be zero.
+ * @return The result.
+ */
+uint64_t pow_mod(const uint64_t base, const uint64_t* e, const std::size_t num, const uint64_t m);
+
+inline uint64_t pow_mod(const uint64_t base, const uint64_t e, const uint64_t m) {
+    return pow_mod(base, &e, 1, m);
+}
+
+/**
+ * Montgomery arithmetic for an odd modulus that fits in a block, where R = 2^64.
+ *
+ * The values in Montgomery form are less than the modulus.
+ */
+class Montgomery64 {
+public:
+    /**
+     * Constructor
+     *
+     * @param n An odd modulus.
+     */
+    explicit Montgomery64(const uint64_t n);
+
+    uint64_t get_modulus() const {
+        return this->n;
+    }
+
+    /**
+     * Returns 1 in Montgomery form.
+     *
+     * @return R mod n.
+     */
+    uint64_t one() const {
+        return this->r1;
+    }
+
+    uint64_t to_montgomery(const uint64_t a) const;
+
+    uint64_t from_montgomery(const uint64_t a) const {
+        return reduce(0, a);
+    }
+
+    /**
+     * Calculate a * b * R^-1 mod n.
+     *
+     * @param a A value in Montgomery form.
+     * @param b A value in Montgomery form.
+     * @return The product in Montgomery form.
+     */
+    uint64_t mul(const uint64_t a, const uint64_t b) const {
+        const unsigned __int128 t = static_cast<unsigned __int128>(a) * b;
+        return reduce(t >> 64, t);
+    }
+
+    /**
+     * Calculate base^e.
+     *
+     * @param base A base in Montgomery form.
+     * @param e The blocks of an exponent. Least significant block first.
+     * @param num The number of blocks of `e`.
+     * @return The result in Montgomery form.
+     */
+    uint64_t pow(const uint64_t base, const uint64_t* e, const std::size_t num) const;
+
+private:
+    uint64_t n;
+    uint64_t ninv; // n^-1 mod R
+    uint64_t r1;   // R mod n
+
+    // (hi * R + lo) * R^-1 mod n, where hi < n.
+    // The lower half of m * n is equal to lo, so no borrow comes from it.
+    uint64_t reduce(const uint64_t hi, const uint64_t lo) const {
+        const uint64_t m = lo * this->ninv;
+        const uint64_t mn_hi = (static_cast<unsigned __int128>(m) * this->n) >> 64;
+        return (hi >= mn_hi) ? hi - mn_hi : hi - mn_hi + this->n;
+    }
+};
+
+/**
+ * Remainders of a number modulo many small divisors.
+ *
+ * The divisors are packed into products that fit in a block. A number is reduced by
+ * the products in one pass over its blocks, and the remainder of each product is
+ * reduced by its divisors. Every step uses a precomputed reciprocal, so it is a
+ * multiplication instead of a division. Lanes products are reduced together, so
+ * their independent steps are executed in parallel.
+ */
+class SmallDivisors {
+public:
+    static constexpr uint64_t Limit = uint64_t(1) << 32;
+    static constexpr std::size_t Lanes = 4;
+
+    /**
+     * Constructor
+     *
+     * @param divisors The divisors. Each of them must be in [2, Limit).
+     */
+    explicit SmallDivisors(const std::vector<uint64_t>& divisors);
+
+    std::size_t size() const {
+        return this->num_divisors;
+    }
+
+    /**
+     * Calculate the remainders in one pass over the blocks.
+     *
+     * @param out The output buffer of size() elements. The i-th element is the remainder
+     *            modulo the i-th divisor.
+     * @param blocks The blocks of a number. Least significant block first.
+     * @param num The number of blocks of `blocks`.
+     */
+    void remainders(uint64_t* out, const uint64_t* blocks, const std::size_t num) const;
+
+private:
+    // A product of consecutive divisors. It is normalized by `shift` so that the MSB is set.
+    struct Product {
+        uint64_t normalized;
+        uint64_t reciprocal; // floor((2^128 - 1) / normalized) - 2^64
+        int shift;
+        std::size_t num_divisors;
+    };
+
+    std::size_t num_divisors;
+    std::vector<uint64_t> divisors;
+    std::vector<uint64_t> divisor_reciprocals; // floor(2^64 / d)
+    std::vector<Product> products; // Padded to a multiple of Lanes
+};
+
 } // namespace gear
 } // namespace grill
 
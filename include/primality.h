@@ -1,13 +1,223 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
 #include "Integer.h"
 
 namespace grill {
 namespace primality {
 
+/**
+ * trivial_division() for an Integer over 2^64 tries the primes less than this value,
+ * and n without such a factor is tested by bpsw_test(). The result for n that fits in
+ * a block is exact.
+ */
+constexpr Integer::block_t TrialDivisionLimit = 1ull << 32;
+
 bool trivial_division(const Integer::block_t n);
 bool trivial_division(const Integer& n);
-bool fermat_test(const Integer& n);
-bool miller_rabin_test(const Integer& n);
+
+/**
+ * The primes less than this value are used by has_small_factor().
+ */
+constexpr Integer::block_t SmallFactorLimit = 1 << 14;
+
+/**
+ * Checks whether n has a small prime factor.
+ *
+ * The primes less than SmallFactorLimit are packed into products that fit in a block.
+ * n is reduced by each product and the gcd of the remainder and the product is
+ * calculated. It costs much less than one modular exponentiation, so it rejects
+ * most random candidates before a probable prime test.
+ *
+ * @param n An Integer to be checked.
+ * @return true if n is divisible by a small prime other than n itself. Otherwise false.
+ */
+bool has_small_factor(const Integer& n);
+
+/**
+ * Returns the primes less than SmallFactorLimit.
+ *
+ * @return The primes in ascending order.
+ */
+const std::vector<Integer::block_t>& get_small_primes();
+
+/**
+ * Calculates the residues of n modulo the small primes.
+ *
+ * @param n An Integer.
+ * @return n mod p for each p of get_small_primes() in the same order.
+ */
+std::vector<Integer::block_t> get_small_prime_residues(const Integer& n);
+
+/**
+ * Fermat primality test.
+ *
+ * @param n An Integer to be tested.
+ * @param small_factor_filter If true, has_small_factor() is called before the test.
+ * @return true if n is a probable prime. Otherwise false.
+ */
+bool fermat_test(const Integer& n, const bool small_factor_filter = false);
+
+/**
+ * Deterministic Miller-Rabin primality test for a number that fits in a block.
+ *
+ * The fixed bases are proven to have no strong pseudoprime less than 2^64.
+ *
+ * @param n A number to be tested.
+ * @return true if n is a prime. Otherwise false.
+ */
+bool miller_rabin_test(const Integer::block_t n);
+
+/**
+ * Miller-Rabin primality test.
+ *
+ * A number that fits in a block is tested by the deterministic overload.
+ *
+ * @param n An Integer to be tested.
+ * @param small_factor_filter If true, has_small_factor() is called before the test.
+ * @return true if n is a probable prime. Otherwise false.
+ */
+bool miller_rabin_test(const Integer& n, const bool small_factor_filter = false);
+
+/**
+ * Calculates the Jacobi symbol (a/n).
+ *
+ * @param a An integer.
+ * @param n An odd positive Integer.
+ * @return 1, -1 or 0.
+ */
+int jacobi_symbol(const std::int64_t a, const Integer& n);
+
+/**
+ * Baillie-PSW primality test.
+ *
+ * It is a strong probable prime test to base 2 followed by a strong Lucas
+ * probable prime test with Selfridge's parameters. No composite number is known
+ * to pass it.
+ *
+ * @param n An Integer to be tested.
+ * @return true if n is a probable prime. Otherwise false.
+ */
+bool bpsw_test(const Integer& n);
+
+//
+// Mersenne and Proth numbers
+//
+
+/**
+ * Returns p if n is a Mersenne number 2^p - 1.
+ *
+ * @param n An Integer.
+ * @return p if n = 2^p - 1 with p >= 1. Otherwise no value.
+ */
+std::optional<std::size_t> get_mersenne_exponent(const Integer& n);
+
+/**
+ * n = k * 2^m + 1
+ */
+struct ProthForm {
+    Integer::block_t k;
+    std::size_t m;
+};
+
+/**
+ * Returns k and m if n is a Proth number k * 2^m + 1 with an odd k < 2^m.
+ *
+ * Only the numbers whose k fits in a block are recognized.
+ *
+ * @param n An Integer.
+ * @return k and m. No value is returned if n is not recognized.
+ */
+std::optional<ProthForm> get_proth_form(const Integer& n);
+
+/**
+ * Lucas-Lehmer test for a Mersenne number.
+ *
+ * The squares are reduced modulo 2^p - 1 by shifts and additions.
+ *
+ * @param p The exponent.
+ * @return true if 2^p - 1 is a prime. Otherwise false.
+ */
+bool lucas_lehmer_test(const std::size_t p);
+
+/**
+ * Proth test.
+ *
+ * n is a prime if and only if a^((n-1)/2) = -1 (mod n) for a quadratic
+ * non-residue a. The squares are reduced modulo k * 2^m + 1 by shifts, additions
+ * and a division by k.
+ *
+ * @param n An Integer recognized by get_proth_form().
+ * @return true if n is a prime. Otherwise false.
+ * @throw std::invalid_argument n is not recognized as a Proth number.
+ */
+bool proth_test(const Integer& n);
+
+//
+// Batch test
+//
+enum class Algorithm {
+    TrivialDivision,
+    FermatTest,
+    MillerRabinTest,
+    BpswTest,
+    LucasLehmerTest,
+    ProthTest,
+    Auto, // Lucas-Lehmer or Proth test if the form is recognized. Otherwise Baillie-PSW test.
+};
+
+/**
+ * Test an Integer by an algorithm.
+ *
+ * @param n An Integer to be tested.
+ * @param algorithm The algorithm. The small factor filter is used for the Fermat and
+ *                  Miller-Rabin tests.
+ * @return true if n is a (probable) prime. Otherwise false.
+ * @throw std::invalid_argument n doesn't have the form for the algorithm.
+ */
+bool test(const Integer& n, const Algorithm algorithm);
+
+struct BatchResult {
+    /**
+     * The results in the order of the candidates.
+     */
+    std::vector<bool> is_prime;
+
+    /**
+     * The number of the threads that tested the candidates.
+     */
+    std::size_t num_threads = 0;
+
+    /**
+     * The elapsed time in seconds.
+     */
+    double elapsed = 0;
+
+    /**
+     * @return The number of the tested candidates per second.
+     */
+    double get_throughput() const {
+        return (elapsed > 0) ? is_prime.size() / elapsed : 0;
+    }
+};
+
+/**
+ * Test many candidates in parallel.
+ *
+ * The candidates are taken one by one by the workers of a ThreadPool, so a worker
+ * that got cheap candidates takes more of them. Each worker reuses its own block
+ * allocator for the temporary Integers.
+ *
+ * @param candidates Integers to be tested.
+ * @param algorithm The algorithm.
+ * @param num_threads The number of threads. 0 means the number of the hardware threads.
+ * @return The results.
+ */
+BatchResult test_many(std::span<const Integer> candidates, const Algorithm algorithm,
+                      const std::size_t num_threads = 0);
 
 } // namespace primality
 } // namespace grill
@@ -1,9 +1,21 @@
 #pragma once
+#include <cstddef>
+#include <span>
+#include <vector>
 #include "Integer.h"
 
 namespace grill {
 namespace rsa {
 
+/**
+ * The parameters of the third and later primes of multi-prime RSA (RFC 8017).
+ */
+struct OtherPrimeInfo {
+    Integer prime;       // r_i
+    Integer exponent;    // d mod (r_i - 1)
+    Integer coefficient; // (r_1 * r_2 * ... * r_(i-1))^-1 mod r_i
+};
+
 struct Keys {
     Integer prime1;
     Integer prime2;
@@ -11,15 +23,45 @@ struct Keys {
     Integer modulus;
     Integer public_exponent;
     Integer private_exponent;
+    Integer exponent1;   // d mod (p - 1)
+    Integer exponent2;   // d mod (q - 1)
+    Integer coefficient; // q^-1 mod p
+    std::vector<OtherPrimeInfo> other_primes;
 };
 
+/**
+ * The minimum bit length of the primes of keys. The shorter primes are too few to make
+ * distinct primes whose product has the requested bit length.
+ */
+constexpr std::size_t MinPrimeBits = 16;
+
+/**
+ * Checks the bit length and the number of the primes of keys.
+ *
+ * @param bit_length A bit length of keys.
+ * @param num_primes The number of the primes.
+ * @throw std::invalid_argument num_primes is less than 2, or bit_length / num_primes is
+ *                              less than MinPrimeBits.
+ */
+void check_key_size(const std::size_t bit_length, const std::size_t num_primes);
+
 /**
  * Generate keys.
  *
+ * The primes are searched at the same time by util::get_random_primes(). The first
+ * bit_length % num_primes primes have one more bit than the others, and they are searched
+ * again until the modulus has exactly bit_length bits.
+ *
  * @param bit_length A bit length of the created keys.
+ * @param num_threads The number of the threads that search the primes. 0 means
+ *                    the number of the hardware threads.
+ * @param num_primes The number of the primes. The primes other than prime1 and prime2
+ *                   are stored in other_primes.
  * @return The generated kyes.
+ * @throw std::invalid_argument The arguments don't pass check_key_size().
  */
- Keys generate_keys(const std::size_t bit_length);
+Keys generate_keys(const std::size_t bit_length, const std::size_t num_threads = 0,
+                   const std::size_t num_primes = 2);
 
 /**
  * Encrypt or decrypt data.
@@ -31,5 +73,77 @@ struct Keys {
  */
 Integer compute(const Integer& exponent, const Integer& modulus, const Integer& n);
 
+/**
+ * Decrypt or sign data with the private key by the Chinese remainder theorem.
+ *
+ * n is raised to exponent1 modulo prime1, to exponent2 modulo prime2 and to the exponent
+ * of each other prime, and the results are combined by Garner's formula as in RFC 8017.
+ * Each exponentiation has the size of a prime, so it is several times faster than
+ * compute() with the private exponent.
+ *
+ * @param keys Keys.
+ * @param n An Integer less than the modulus.
+ * @return n^d mod the modulus, where d is the private exponent.
+ */
+Integer compute_private(const Keys& keys, const Integer& n);
+
+//
+// Batch
+//
+
+/**
+ * The default number of the messages in a task of compute_batch().
+ */
+constexpr std::size_t DefaultBatchSize = 64;
+
+struct BatchOptions {
+    /**
+     * The number of the threads. 0 means the number of the hardware threads.
+     */
+    std::size_t num_threads = 0;
+
+    /**
+     * The number of the messages in a task.
+     */
+    std::size_t batch_size = DefaultBatchSize;
+
+    /**
+     * The maximum number of the queued tasks. 0 means twice the number of the threads.
+     */
+    std::size_t queue_size = 0;
+};
+
+/**
+ * Encrypt or decrypt many messages with one key.
+ *
+ * The messages are computed by a ThreadPool in tasks of batch_size. An odd modulus
+ * is calculated by batch_pow_mod::calc() for each task, which computes the messages
+ * of a task in the SIMD lanes where the CPU supports it.
+ *
+ * @param exponent An exponent.
+ * @param modulus A modulus.
+ * @param messages Integers to be encrypted or decrypted.
+ * @param options Options.
+ * @return The results in the order of the messages.
+ * @throw std::invalid_argument batch_size is 0.
+ */
+std::vector<Integer> compute_batch(const Integer& exponent, const Integer& modulus,
+                                   std::span<const Integer> messages,
+                                   const BatchOptions& options = BatchOptions());
+
+/**
+ * Decrypt or sign many messages with the private key by compute_private().
+ *
+ * The contexts of the primes are looked up once and shared by all the messages.
+ *
+ * @param keys Keys.
+ * @param messages Integers less than the modulus.
+ * @param options Options.
+ * @return The results in the order of the messages.
+ * @throw std::invalid_argument batch_size is 0.
+ */
+std::vector<Integer> compute_private_batch(const Keys& keys, std::span<const Integer> messages,
+                                           const BatchOptions& options = BatchOptions());
+
 } // namespace rsa
 } // namespace grill
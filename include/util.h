@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 #include "Integer.h"
 
 namespace grill {
@@ -52,9 +53,25 @@ Integer get_random(const std::size_t bit_length);
  * Return a random prime number.
  *
  * @param bit_length A bit length of the created prime number. It must be greater than 2.
- * @return The random prime number.
+ * @return The random prime number. Its most significant bit is at bit_length.
  */
 Integer get_random_prime(const std::size_t bit_length);
 
+/**
+ * Return random prime numbers searched in parallel.
+ *
+ * The workers test the candidates from their own random starts speculatively.
+ * Each found prime is taken until count primes are found, and then the other
+ * workers stop.
+ *
+ * @param bit_length A bit length of the created prime numbers. It must be greater than 2.
+ *                   The most significant bit of each prime number is at bit_length.
+ * @param count The number of the prime numbers.
+ * @param num_threads The number of the workers. 0 means the number of the hardware threads.
+ * @return The random prime numbers in the order found. They are not always distinct.
+ */
+std::vector<Integer> get_random_primes(const std::size_t bit_length, const std::size_t count,
+                                       const std::size_t num_threads = 0);
+
 } // namespace util
 } // namespace grill
@@ -2,10 +2,12 @@
 #include <cstdio>
 #include <cstring>
 #include <sstream>
+#include <mutex>
 #include "Integer.h"
 #include "BlockAllocator.h"
 #include "ExpandableArray.h"
 #include "constant.h"
+#include "ModContextCache.h"
 
 namespace grill {
 
@@ -33,6 +35,24 @@ static constexpr Integer::block_t BitMask[] = {
 
 __thread BlockAllocator<Integer::block_t> *Integer::allocator = nullptr;
 
+// The cached blocks of a thread are deleted when the thread exits. Otherwise the blocks freed
+// by a worker thread are leaked. The allocator itself is kept for the same reason as
+// get_allocator().
+struct AllocatorCacheReleaser {
+    BlockAllocator<Integer::block_t>* allocator = nullptr;
+
+    ~AllocatorCacheReleaser() {
+        if (this->allocator != nullptr)
+            this->allocator->release_caches();
+    }
+};
+
+void Integer::create_allocator() {
+    static thread_local AllocatorCacheReleaser releaser;
+    allocator = new BlockAllocator<block_t>;
+    releaser.allocator = allocator;
+}
+
 static std::string create_error_msg(const char* const filename, const int lineno,
                                     const char* const msg) {
     std::stringstream ss;
@@ -48,24 +68,6 @@ static bool is_valid_index(const std::size_t num_blocks, const int idx) {
     return static_cast<std::size_t>(idx) < num_blocks;
 }
 
-static std::size_t get_num_compact_blocks(const Integer::block_t* blocks,
-                                          const std::size_t num_blocks) {
-    std::size_t idx = num_blocks;
-    while (idx >= 2) {
-        if (blocks[idx-1] != 0)
-            break;
-        idx--;
-    }
-    return idx;
-}
-
-struct CompactedInteger : public Integer {
-    CompactedInteger(const Integer::block_t* data, const std::size_t num_blocks)
-    : Integer(get_num_compact_blocks(data, num_blocks)) {
-        gear::copy(get_blocks(), data, get_num_blocks());
-    }
-};
-
 //
 // public methods
 //
@@ -90,68 +92,167 @@ std::ostream& operator<<(std::ostream& os, const Integer& data) {
 }
 
 Integer& Integer::operator=(Integer&& n) {
-    get_allocator()->free(this->blocks);
+    if (this == &n)
+        return *this;
 
+    // A moved-from Integer can be assigned, for example, by std::swap().
+    free_blocks();
     this->num_blocks = n.num_blocks;
-    this->blocks = n.blocks,
-    n.blocks = nullptr;
-
+    this->capacity = n.capacity;
+    take_blocks(n);
     return *this;
 }
 
+Integer Integer::from_blocks(const block_t* blocks, const std::size_t num_blocks,
+                             const std::size_t n) {
+    Integer x(n);
+    const std::size_t num_copy = std::min(num_blocks, n);
+    gear::copy(x.blocks, blocks, num_copy);
+    gear::fill_zero(&x.blocks[num_copy], n - num_copy);
+    return x;
+}
+
+void Integer::reserve(const std::size_t n) {
+    if (n <= this->capacity)
+        return;
+    block_t* new_blocks = get_allocator()->take(n);
+    gear::copy(new_blocks, this->blocks, this->num_blocks);
+    free_blocks();
+    this->blocks = new_blocks;
+    this->capacity = n;
+}
+
+void Integer::shrink_to_fit() {
+    if (is_inline() || this->capacity == this->num_blocks)
+        return;
+    block_t* new_blocks = (this->num_blocks <= NumInlineBlocks)
+                          ? this->inline_blocks
+                          : get_allocator()->take(this->num_blocks);
+    gear::copy(new_blocks, this->blocks, this->num_blocks);
+    free_blocks();
+    this->blocks = new_blocks;
+    this->capacity = std::max(this->num_blocks, NumInlineBlocks);
+}
+
+// The capacity grows at least twice, so repeated growth is amortized.
+// The added blocks are zero.
+void Integer::resize(const std::size_t n) {
+    if (n > this->capacity)
+        reserve(std::max(n, 2 * this->capacity));
+    if (n > this->num_blocks)
+        gear::fill_zero(&this->blocks[this->num_blocks], n - this->num_blocks);
+    this->num_blocks = n;
+}
+
+// A result that fits in the inline blocks is moved there, so it doesn't hold the
+// allocator's blocks.
+void Integer::trim() {
+    this->num_blocks = gear::get_num_active_blocks(this->blocks, this->num_blocks);
+    if (this->num_blocks <= NumInlineBlocks)
+        shrink_to_fit();
+}
+
+void Integer::assign_blocks(const block_t* src, const std::size_t n) {
+    if (n > this->capacity)
+        reserve(std::max(n, 2 * this->capacity));
+    gear::copy(this->blocks, src, n);
+    this->num_blocks = n;
+}
+
 Integer& Integer::operator+=(const Integer& n) {
-    return *this = (*this) + n;
+    if (&n == this)
+        return *this = (*this) + n;
+    resize(std::max(this->num_blocks, n.num_blocks) + 1);
+    gear::add(this->blocks, this->num_blocks, n.blocks, n.num_blocks);
+    this->num_blocks = gear::get_num_active_blocks(this->blocks, this->num_blocks);
+    return *this;
 }
 
 Integer& Integer::operator-=(const Integer& n) {
-    const std::size_t num_blocks = get_num_blocks();
-    Integer::block_t* blocks = get_blocks();
-    gear::sub(blocks, num_blocks, n.ref_blocks(), n.get_num_blocks());
-    if (blocks[num_blocks-1] == 0)
-        *this = CompactedInteger(blocks, num_blocks);
+    gear::sub(this->blocks, this->num_blocks, n.ref_blocks(), n.get_num_blocks());
+    this->num_blocks = gear::get_num_active_blocks(this->blocks, this->num_blocks);
     return *this;
 }
 
 Integer& Integer::operator*=(const Integer& n) {
-    return *this = (*this) * n;
+    const std::size_t num_result_blocks = this->num_blocks + n.num_blocks;
+    block_t result[num_result_blocks];
+    gear::karatsuba(result, num_result_blocks,
+                    this->blocks, this->num_blocks, n.blocks, n.num_blocks);
+    assign_blocks(result, gear::get_num_active_blocks(result, num_result_blocks));
+    return *this;
+}
+
+// r is reduced to the remainder of r / rhs. The bits of the quotient are set to q
+// unless it is null.
+static void divide(Integer& r, const Integer& rhs, Integer* q) {
+    const int lhs_msb = r.most_significant_active_bit();
+    const int rhs_msb = rhs.most_significant_active_bit();
+    if (rhs_msb == 0)
+        throw std::out_of_range("Divided by zero");
+
+    for (int b = lhs_msb - rhs_msb; b >= 0; b--) {
+        Integer x = rhs * Integer::pow2(b);
+        if (r >= x) {
+            if (q != nullptr)
+                q->set_bit_value(b, true);
+            r -= x;
+            if (r.is_zero())
+                break;
+        }
+    }
 }
 
 Integer& Integer::operator/=(const Integer& n) {
-    return *this = (*this) / n;
+    if (&n == this)
+        return *this /= Integer(n);
+    // Checked before *this is cleared, so that it is kept on the exception.
+    if (n.is_zero())
+        throw std::out_of_range("Divided by zero");
+    Integer r(*this);
+    resize(1);
+    this->blocks[0] = 0;
+    divide(r, n, this);
+    return *this;
 }
 
 Integer& Integer::operator%=(const Integer& n) {
-    return *this = (*this) % n;
+    if (&n == this)
+        return *this %= Integer(n);
+    divide(*this, n, nullptr);
+    return *this;
 }
 
+// The binary operators calculate in the storage of the result, which has the blocks for
+// the largest result, and trim the number of blocks afterwards.
 Integer Integer::operator+(const Integer& rhs) const {
     const Integer& lhs = *this;
     const std::size_t num_lhs_blocks = lhs.get_num_blocks();
     const std::size_t num_rhs_blocks = rhs.get_num_blocks();
-    const std::size_t num_result_blocks = std::max(num_lhs_blocks, num_rhs_blocks) + 1;
-    Integer::block_t result[num_result_blocks];
-    gear::copy(result, lhs.get_blocks(), num_lhs_blocks);
-    gear::fill_zero(&result[num_lhs_blocks], num_result_blocks - num_lhs_blocks);
-    gear::add(result, num_result_blocks, rhs.ref_blocks(), num_rhs_blocks);
-    return CompactedInteger(result, num_result_blocks);
+    Integer result(std::max(num_lhs_blocks, num_rhs_blocks) + 1);
+    block_t* blocks = result.get_blocks();
+    gear::copy(blocks, lhs.get_blocks(), num_lhs_blocks);
+    gear::fill_zero(&blocks[num_lhs_blocks], result.num_blocks - num_lhs_blocks);
+    gear::add(blocks, result.num_blocks, rhs.ref_blocks(), num_rhs_blocks);
+    result.trim();
+    return result;
 }
 
 Integer Integer::operator-(const Integer& r) const {
-    const std::size_t num_blocks = get_num_blocks();
-    Integer::block_t buf[num_blocks];
-    gear::copy(buf, ref_blocks(), num_blocks);
-    gear::sub(buf, num_blocks, r.ref_blocks(), r.get_num_blocks());
-    return CompactedInteger(buf, num_blocks);
+    Integer result(*this);
+    gear::sub(result.get_blocks(), result.num_blocks, r.ref_blocks(), r.get_num_blocks());
+    result.trim();
+    return result;
 }
 
 Integer Integer::operator*(const Integer& rhs) const {
     const Integer& lhs = *this;
-    const std::size_t num_result_blocks = lhs.get_num_blocks() + rhs.get_num_blocks();
-    Integer::block_t result[num_result_blocks];
-    gear::karatsuba(result, num_result_blocks,
+    Integer result(lhs.get_num_blocks() + rhs.get_num_blocks());
+    gear::karatsuba(result.get_blocks(), result.num_blocks,
                     lhs.get_blocks(), lhs.get_num_blocks(),
                     rhs.get_blocks(), rhs.get_num_blocks());
-    return CompactedInteger(result, num_result_blocks);
+    result.trim();
+    return result;
 }
 
 struct DivSolution {
@@ -165,24 +266,11 @@ struct DivSolution {
 };
 
 static DivSolution div(const Integer& lhs, const Integer& rhs) {
-    const int lhs_msb = lhs.most_significant_active_bit();
-    const int rhs_msb = rhs.most_significant_active_bit();
-    if (rhs_msb == 0)
-        throw std::out_of_range("Divided by zero");
-
     DivSolution sol {
         constant::Zero,
         Integer(lhs),
     };
-    for (int b = lhs_msb - rhs_msb; b >= 0; b--) {
-        Integer x = rhs * Integer::pow2(b);
-        if (sol.r >= x) {
-            sol.q.set_bit_value(b, true);
-            sol.r -= x;
-            if (sol.r.is_zero())
-                break;
-        }
-    }
+    divide(sol.r, rhs, &sol.q);
     return sol;
 }
 
@@ -358,15 +446,7 @@ Integer& Integer::set_bit_value(const int b, const bool v) {
     if (block_idx >= get_num_blocks()) {
         if (!v)
             return *this;
-        const std::size_t num_new_blocks = block_idx + 1;
-        const std::size_t num_old_blocks = get_num_blocks();
-        Integer n(num_new_blocks);
-
-        const std::size_t num_zero_blocks = num_new_blocks - num_old_blocks;
-        block_t* new_blocks = n.get_blocks();
-        gear::copy(new_blocks, ref_blocks(), num_old_blocks);
-        gear::fill_zero(&new_blocks[num_old_blocks], num_zero_blocks);
-        *this = std::move(n);
+        resize(block_idx + 1);
     }
     if (v)
         this->blocks[block_idx] |= BitMask[mask_idx];
@@ -375,34 +455,29 @@ Integer& Integer::set_bit_value(const int b, const bool v) {
     return *this;
 }
 
-template<bool MODULO>
-Integer pow_template(const Integer& base, const Integer& e, const Integer& mod) {
+Integer Integer::pow(const Integer& e) const {
     const int most_significant_active_bit = e.most_significant_active_bit();
     Integer n = constant::One;
-    Integer x = base; // the power of base
+    Integer x = *this; // the power of base
     for (int b = 0; b < most_significant_active_bit; b++) {
-        if (e.get_bit_value(b)) {
+        if (e.get_bit_value(b))
             n *= x;
-            if (MODULO)
-                n %= mod;
-        }
         x *= x;
-        if (MODULO)
-            x %= mod;
     }
     return n;
 }
 
-Integer Integer::pow(const Integer& e) const {
-    return pow_template<false>(*this, e, constant::One);
-}
-
 Integer Integer::pow_mod(const Integer& e, const Integer& mod) const {
-    return pow_template<true>(*this, e, mod);
+    if (mod.fits_in_block() && !mod.is_zero()) {
+        const block_t m = mod.blocks[0];
+        const block_t base = gear::remainder(this->blocks, this->num_blocks, m);
+        return Integer({gear::pow_mod(base, e.blocks, e.num_blocks, m)});
+    }
+    return ModContextCache::get_instance().get(mod)->pow(*this, e);
 }
 
-// TODO: Be thread safe
 static ExpandableArray<Integer*> pow2_array;
+static std::mutex pow2_array_mutex;
 
 static void fill_pow2(Integer::block_t* blocks, const std::size_t num_blocks, const int e) {
     const int idx = e % Integer::BlockBits;
@@ -411,6 +486,7 @@ static void fill_pow2(Integer::block_t* blocks, const std::size_t num_blocks, co
 }
 
 const Integer& Integer::pow2(const int e) {
+    std::lock_guard<std::mutex> lock(pow2_array_mutex);
     const std::size_t required_size = e + 1;
     const std::size_t curr_size = pow2_array.get_size();
     if (curr_size < required_size) {
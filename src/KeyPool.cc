@@ -0,0 +1,160 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "KeyPool.h"
+#include "ThreadPool.h"
+
+namespace grill {
+namespace rsa {
+
+KeyPool::KeyPool(const std::vector<Spec>& specs, const std::size_t num_threads)
+: start_time(std::chrono::steady_clock::now()) {
+    for (const Spec& spec: specs) {
+        if (spec.capacity == 0)
+            throw std::invalid_argument("capacity must be greater than 0");
+        check_key_size(spec.bit_length, spec.num_primes);
+        if (!this->slots.emplace(spec.bit_length, Slot{spec}).second)
+            throw std::invalid_argument("bit_length is duplicated");
+    }
+    const std::size_t n = ThreadPool::resolve_num_threads(num_threads);
+    for (std::size_t i = 0; i < n; i++)
+        this->workers.emplace_back(&KeyPool::work, this);
+}
+
+KeyPool::~KeyPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->refill_cond.notify_all();
+    this->ready_cond.notify_all();
+    for (auto& th: this->workers)
+        th.join();
+}
+
+Keys KeyPool::take(const std::size_t bit_length) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    Slot& slot = this->get_slot(bit_length);
+    if (slot.keys.empty() && !slot.error) {
+        slot.num_waits++;
+        this->ready_cond.wait(lock, [&] {
+            return this->stopping || slot.error || !slot.keys.empty();
+        });
+    }
+    if (slot.keys.empty() && !slot.error)
+        throw std::runtime_error("KeyPool is destroyed");
+    return this->pop_keys(slot, lock);
+}
+
+std::optional<Keys> KeyPool::try_take(const std::size_t bit_length) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    Slot& slot = this->get_slot(bit_length);
+    if (slot.keys.empty() && !slot.error)
+        return std::nullopt;
+    return this->pop_keys(slot, lock);
+}
+
+KeyPool::Metrics KeyPool::get_metrics(const std::size_t bit_length) const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    const Slot& slot = this->get_slot(bit_length);
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - this->start_time;
+    Metrics metrics;
+    metrics.depth = slot.keys.size();
+    metrics.capacity = slot.spec.capacity;
+    metrics.num_generated = slot.num_generated;
+    metrics.num_taken = slot.num_taken;
+    metrics.num_waits = slot.num_waits;
+    metrics.refill_rate = (elapsed.count() > 0) ? slot.num_generated / elapsed.count() : 0;
+    return metrics;
+}
+
+KeyPool::Slot& KeyPool::get_slot(const std::size_t bit_length) {
+    const auto it = this->slots.find(bit_length);
+    if (it == this->slots.end())
+        throw std::invalid_argument("Unknown bit_length: " + std::to_string(bit_length));
+    return it->second;
+}
+
+const KeyPool::Slot& KeyPool::get_slot(const std::size_t bit_length) const {
+    return const_cast<KeyPool*>(this)->get_slot(bit_length);
+}
+
+// The keys at the front, or the error of the slot, which is rethrown only once.
+// The lock is released and a worker is woken up to refill the slot.
+Keys KeyPool::pop_keys(Slot& slot, std::unique_lock<std::mutex>& lock) {
+    std::exception_ptr error = std::exchange(slot.error, nullptr);
+    std::optional<Keys> keys;
+    if (!error) {
+        keys = std::move(slot.keys.front());
+        slot.keys.pop_front();
+        slot.num_taken++;
+    }
+    lock.unlock();
+    this->refill_cond.notify_one();
+    if (error)
+        std::rethrow_exception(error);
+    return std::move(*keys);
+}
+
+// The slot with the lowest ratio of the ready and generating keys to the capacity.
+// The ratios are compared by cross multiplication. A slot with an error is skipped.
+KeyPool::Slot* KeyPool::find_slot_to_refill() {
+    Slot* found = nullptr;
+    std::size_t found_num = 0;
+    for (auto& [bit_length, slot]: this->slots) {
+        const std::size_t num = slot.keys.size() + slot.num_generating;
+        if (num >= slot.spec.capacity || slot.error)
+            continue;
+        if (!found || num * found->spec.capacity < found_num * slot.spec.capacity) {
+            found = &slot;
+            found_num = num;
+        }
+    }
+    return found;
+}
+
+void KeyPool::work() {
+    // The workers only use the CPU time left by other threads. The pool works
+    // without it where the policy is unavailable.
+#ifdef SCHED_IDLE
+    const sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        Slot* slot = nullptr;
+        this->refill_cond.wait(lock, [&] {
+            slot = this->find_slot_to_refill();
+            return this->stopping || slot;
+        });
+        if (this->stopping)
+            return;
+
+        slot->num_generating++;
+        const Spec spec = slot->spec;
+        lock.unlock();
+        std::optional<Keys> keys;
+        std::exception_ptr error;
+        try {
+            keys = generate_keys(spec.bit_length, 1, spec.num_primes);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        slot->num_generating--;
+        if (keys) {
+            slot->num_generated++;
+            slot->keys.emplace_back(std::move(*keys));
+        } else {
+            slot->error = error;
+        }
+        this->ready_cond.notify_all();
+    }
+}
+
+} // namespace rsa
+} // namespace grill
@@ -0,0 +1,96 @@
+#include "ModContextCache.h"
+
+namespace grill {
+
+// FNV-1a over the active blocks, so leading zero blocks don't change the hash.
+static std::size_t calc_hash(const Integer& n) {
+    const Integer::block_t* blocks = n.ref_blocks();
+    const std::size_t num_blocks = gear::get_num_active_blocks(blocks, n.get_num_blocks());
+
+    std::size_t hash = 0xcbf2'9ce4'8422'2325;
+    for (std::size_t i = 0; i < num_blocks; i++) {
+        hash ^= blocks[i];
+        hash *= 0x0000'0100'0000'01b3;
+    }
+    return hash;
+}
+
+ModContextCache& ModContextCache::get_instance() {
+    static ModContextCache instance;
+    return instance;
+}
+
+std::shared_ptr<const ModContext> ModContextCache::get(const Integer& modulus) {
+    const std::size_t hash = calc_hash(modulus);
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        const auto it = this->context_map.find(hash);
+        if (it != this->context_map.end() && (*it->second)->get_modulus() == modulus) {
+            this->num_hits++;
+            this->contexts.splice(this->contexts.begin(), this->contexts, it->second);
+            return this->contexts.front();
+        }
+        this->num_misses++;
+    }
+
+    // The creation is done without the lock because it can take a long time.
+    auto context = std::make_shared<const ModContext>(modulus);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->capacity == 0)
+        return context;
+
+    const auto it = this->context_map.find(hash);
+    if (it != this->context_map.end()) {
+        // Another thread has stored the same modulus, or the hash collides.
+        this->contexts.erase(it->second);
+        this->context_map.erase(it);
+    }
+    this->contexts.push_front(context);
+    this->context_map.emplace(hash, this->contexts.begin());
+    evict(this->capacity);
+    return context;
+}
+
+void ModContextCache::set_capacity(const std::size_t capacity) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->capacity = capacity;
+    evict(capacity);
+}
+
+std::size_t ModContextCache::get_capacity() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->capacity;
+}
+
+std::size_t ModContextCache::get_size() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->contexts.size();
+}
+
+std::size_t ModContextCache::get_num_hits() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->num_hits;
+}
+
+std::size_t ModContextCache::get_num_misses() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->num_misses;
+}
+
+void ModContextCache::clear() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->contexts.clear();
+    this->context_map.clear();
+    this->num_hits = 0;
+    this->num_misses = 0;
+}
+
+void ModContextCache::evict(const std::size_t max_size) {
+    while (this->contexts.size() > max_size) {
+        this->context_map.erase(calc_hash(this->contexts.back()->get_modulus()));
+        this->contexts.pop_back();
+    }
+}
+
+} // namespace grill
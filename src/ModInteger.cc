@@ -0,0 +1,681 @@
+#include <algorithm>
+#include <stdexcept>
+#include <ostream>
+#include <vector>
+#include "ModInteger.h"
+#include "constant.h"
+
+namespace grill {
+
+using block_t = Integer::block_t;
+
+// n must be less than 2^(64*num_blocks).
+static void copy_blocks(block_t* out, const Integer& n, const std::size_t num_blocks) {
+    const std::size_t num_copy = std::min(n.get_num_blocks(), num_blocks);
+    gear::copy(out, n.ref_blocks(), num_copy);
+    gear::fill_zero(&out[num_copy], num_blocks - num_copy);
+}
+
+// n in num_blocks blocks. It must be less than 2^(64*num_blocks).
+static Integer resize(const Integer& n, const std::size_t num_blocks) {
+    return Integer::from_blocks(n.ref_blocks(), n.get_num_blocks(), num_blocks);
+}
+
+static Integer create_pow2(const int e) {
+    Integer n = constant::Zero;
+    n.set_bit_value(e, true);
+    return n;
+}
+
+// r = 2r mod m, where r < m.
+static void double_mod(block_t* r, const block_t* m, const std::size_t num_blocks) {
+    const bool overflow = r[num_blocks-1] >> (Integer::BlockBits - 1);
+    for (std::size_t i = num_blocks - 1; i > 0; i--)
+        r[i] = (r[i] << 1) | (r[i-1] >> (Integer::BlockBits - 1));
+    r[0] <<= 1;
+    if (overflow || gear::compare(r, m, num_blocks) >= 0)
+        gear::sub(r, num_blocks, m, num_blocks);
+}
+
+static std::size_t calc_num_blocks(const int bits) {
+    return std::max(1, (bits + Integer::BlockBits - 1) / Integer::BlockBits);
+}
+
+static Integer shift_left(const Integer& n, const int bits) {
+    Integer x = resize(n, calc_num_blocks(n.most_significant_active_bit() + bits));
+    x <<= bits;
+    return x;
+}
+
+static Integer shift_right(const Integer& n, const int bits) {
+    const int num_bits = n.most_significant_active_bit() - bits;
+    if (num_bits <= 0)
+        return constant::Zero;
+    Integer x(n);
+    x >>= bits;
+    return resize(x, calc_num_blocks(num_bits));
+}
+
+// The reciprocal is calculated by Newton's method, which doubles the precision in every
+// step. So it costs a few multiplications of the full size even for a huge modulus.
+static constexpr int GuardBits = 64;
+
+// Returns floor(2^s / m) or a value less than it by two at most.
+static Integer calc_reciprocal(const Integer& m, const int s) {
+    const int k = m.most_significant_active_bit();
+    const int n = s - k + 1; // The result has n or n + 1 bits.
+    if (k > n + GuardBits) {
+        // The reciprocal of the upper bits of m is greater than that of m by one at most.
+        const int d = k - (n + GuardBits);
+        Integer y = calc_reciprocal(shift_right(m, d), s - d);
+        if (!y.is_zero())
+            y -= constant::One;
+        return y;
+    }
+    if (n <= GuardBits)
+        return create_pow2(s) / m;
+
+    // y0 = yh * 2^d has the upper h bits of the result, and y0 <= 2^s / m. The relative
+    // error of y0 is less than 2^(2-h), so that of y1 = y0 + y0 * e / 2^s is less than
+    // 2^(4-2h), where e = 2^s - m * y0. The truncations make y1 less than the result by
+    // one at most. The lower bits of e are dropped because they hardly affect y1.
+    const int h = n / 2 + GuardBits / 2;
+    const int d = n - h;
+    const Integer yh = calc_reciprocal(m, s - d);
+    Integer e = create_pow2(s) - shift_left(m * yh, d);
+    const int t = std::max(0, s - d - h - 1 - GuardBits);
+    const Integer delta = shift_right(yh * shift_right(e, t), s - d - t);
+    Integer y = shift_left(yh, d) + delta;
+    e -= m * delta;
+    while (e >= m) {
+        y += constant::One;
+        e -= m;
+    }
+    return y;
+}
+
+//
+// ModContext
+//
+ModContext::ModContext(const Integer& mod, const Reduction reduction)
+: modulus(resize(mod, gear::get_num_active_blocks(mod.ref_blocks(), mod.get_num_blocks()))),
+  num_blocks(this->modulus.get_num_blocks()),
+  montgomery(mod.is_odd() && reduction == Reduction::Auto),
+  r1(constant::Zero),
+  r2(constant::Zero),
+  mu(constant::Zero) {
+    if (mod.is_zero())
+        throw std::invalid_argument("The modulus must not be zero");
+
+    const std::size_t k = this->num_blocks;
+    const block_t* m = this->modulus.ref_blocks();
+    if (this->montgomery) {
+        this->n0inv = gear::montgomery_n0inv(m[0]);
+
+        block_t buf[k];
+        gear::copy(buf, m, k);
+        gear::twos_complement(buf, k); // R - m
+        this->r1 = resize(Integer::from_blocks(buf, k) % this->modulus, k);
+
+        gear::copy(buf, this->r1.ref_blocks(), k);
+        for (std::size_t i = 0; i < k * Integer::BlockBits; i++)
+            double_mod(buf, m, k);
+        this->r2 = Integer::from_blocks(buf, k);
+    } else {
+        // mu may be less than floor(R^2 / modulus) by two, and it is b^(k+1) - 1 instead of
+        // b^(k+1) for the modulus b^(k-1), where b = 2^64. Either only makes the estimated
+        // quotient of barrett_reduce() smaller by a few.
+        const int s = 2 * k * Integer::BlockBits;
+        const Integer reciprocal = calc_reciprocal(this->modulus, s);
+        if (reciprocal.most_significant_active_bit() > int((k + 1) * Integer::BlockBits)) {
+            const std::vector<block_t> ones(k + 1, ~block_t(0));
+            this->mu = Integer::from_blocks(ones.data(), k + 1);
+        } else {
+            this->mu = resize(reciprocal, k + 1);
+        }
+    }
+
+    const int bits = this->modulus.most_significant_active_bit();
+    const std::size_t num = (bits + 2 + gear::Limb52Bits - 1) / gear::Limb52Bits; // 4n < R
+    if (this->montgomery && bits >= Limb52MinBits && num <= gear::MaxNumLimbs52 &&
+        gear::is_ifma_supported()) {
+        const std::size_t size = gear::get_limb52_buffer_size(num);
+        const Integer r2_52 = pow(constant::Two, Integer({2 * gear::Limb52Bits * num}));
+        Limbs52& limbs = this->limbs52;
+        limbs.n.resize(size);
+        gear::to_limbs52(limbs.n.data(), size, m, k);
+        limbs.r2.resize(size);
+        gear::to_limbs52(limbs.r2.data(), size, r2_52.ref_blocks(), r2_52.get_num_blocks());
+        limbs.n0inv = this->n0inv & ((static_cast<block_t>(1) << gear::Limb52Bits) - 1);
+        limbs.num = num;
+    }
+}
+
+Integer ModContext::pow(const Integer& base, const Integer& e) const {
+    const std::size_t k = this->num_blocks;
+    block_t buf[k];
+    if (this->limbs52.num > 0 && !is_small_base(base)) {
+        reduce(buf, base);
+        pow52(buf, buf, e);
+        return Integer::from_blocks(buf, gear::get_num_active_blocks(buf, k));
+    }
+    pow(buf, base, e);
+    return to_Integer(buf);
+}
+
+void ModContext::pow(block_t* out, const Integer& base, const Integer& e) const {
+    if (is_small_base(base)) {
+        pow_small_base(out, base.ref_blocks()[0], e);
+    } else if (this->limbs52.num > 0) {
+        reduce(out, base);
+        pow52(out, out, e);
+        mul(out, out, this->r2.ref_blocks());
+    } else {
+        to_internal(out, base);
+        pow(out, out, e);
+    }
+}
+
+void ModContext::to_internal(block_t* out, const Integer& n) const {
+    if (n >= this->modulus) {
+        reduce_to_internal(out, n);
+        return;
+    }
+    copy_blocks(out, n, this->num_blocks);
+    if (this->montgomery)
+        mul(out, out, this->r2.ref_blocks());
+}
+
+void ModContext::reduce(block_t* out, const Integer& n) const {
+    const std::size_t k = this->num_blocks;
+    if (!(n >= this->modulus)) {
+        copy_blocks(out, n, k);
+        return;
+    }
+    reduce_to_internal(out, n);
+    if (this->montgomery) {
+        block_t one[k];
+        one[0] = 1;
+        gear::fill_zero(&one[1], k - 1);
+        mul(out, out, one);
+    }
+}
+
+// n is reduced piece by piece from the most significant one, and each step costs a few
+// multiplications of the context instead of a long division.
+void ModContext::reduce_to_internal(block_t* out, const Integer& n) const {
+    const std::size_t k = this->num_blocks;
+    const block_t* m = this->modulus.ref_blocks();
+    const block_t* blocks = n.ref_blocks();
+    const std::size_t num = gear::get_num_active_blocks(blocks, n.get_num_blocks());
+
+    // A piece p < 2^(64*piece_size) is added as out = out * 2^(64*piece_size) + p.
+    const auto load_piece = [&](block_t* x, const std::size_t i, const std::size_t piece_size) {
+        const std::size_t pos = i * piece_size;
+        const std::size_t num_copy = std::min(piece_size, num - pos);
+        gear::copy(x, &blocks[pos], num_copy);
+        gear::fill_zero(&x[num_copy], piece_size - num_copy);
+    };
+
+    gear::fill_zero(out, k);
+    if (this->montgomery) {
+        // Pieces of k blocks in Montgomery form. mul() by R^2 turns a number less than R,
+        // such as a piece, into x * R mod m.
+        const block_t* r2 = this->r2.ref_blocks();
+        block_t x[k];
+        for (std::size_t i = (num + k - 1) / k; i > 0; i--) {
+            load_piece(x, i - 1, k);
+            mul(out, out, r2);
+            mul(x, x, r2);
+            add(out, out, x);
+        }
+    } else if (k == 1) {
+        out[0] = gear::remainder(blocks, num, m[0]);
+    } else if (num <= 2 * k) {
+        barrett_reduce(out, blocks, num);
+    } else {
+        // Pieces of k blocks. out * 2^(64k) + p has 2k blocks as barrett_reduce() requires.
+        block_t x[2 * k];
+        for (std::size_t i = (num + k - 1) / k; i > 0; i--) {
+            load_piece(x, i - 1, k);
+            gear::copy(&x[k], out, k);
+            barrett_reduce(out, x, 2 * k);
+        }
+    }
+}
+
+Integer ModContext::to_Integer(const block_t* in) const {
+    const std::size_t k = this->num_blocks;
+    block_t buf[k];
+    if (this->montgomery) {
+        block_t one[k];
+        one[0] = 1;
+        gear::fill_zero(&one[1], k - 1);
+        mul(buf, in, one);
+    } else {
+        gear::copy(buf, in, k);
+    }
+    return Integer::from_blocks(buf, gear::get_num_active_blocks(buf, k));
+}
+
+void ModContext::set_one(block_t* out) const {
+    if (this->montgomery) {
+        gear::copy(out, this->r1.ref_blocks(), this->num_blocks);
+    } else {
+        out[0] = 1;
+        gear::fill_zero(&out[1], this->num_blocks - 1);
+    }
+}
+
+void ModContext::add(block_t* out, const block_t* a, const block_t* b) const {
+    const std::size_t k = this->num_blocks;
+    const block_t* m = this->modulus.ref_blocks();
+    block_t buf[k];
+    gear::copy(buf, a, k);
+    const bool carry = gear::add(buf, k, b, k);
+    if (carry || gear::compare(buf, m, k) >= 0)
+        gear::sub(buf, k, m, k);
+    gear::copy(out, buf, k);
+}
+
+void ModContext::sub(block_t* out, const block_t* a, const block_t* b) const {
+    const std::size_t k = this->num_blocks;
+    block_t buf[k];
+    gear::copy(buf, a, k);
+    if (gear::sub(buf, k, b, k))
+        gear::add(buf, k, this->modulus.ref_blocks(), k);
+    gear::copy(out, buf, k);
+}
+
+void ModContext::mul(block_t* out, const block_t* a, const block_t* b) const {
+    const std::size_t k = this->num_blocks;
+    if (this->montgomery) {
+        gear::montgomery_mul(out, a, b, this->modulus.ref_blocks(), k, this->n0inv);
+        return;
+    }
+    block_t x[2 * k];
+    gear::karatsuba(x, 2 * k, a, k, b, k);
+    barrett_reduce(out, x, 2 * k);
+}
+
+void ModContext::square(block_t* out, const block_t* a) const {
+    if (this->montgomery) {
+        gear::montgomery_sqr(out, a, this->modulus.ref_blocks(), this->num_blocks, this->n0inv);
+        return;
+    }
+    mul(out, a, a);
+}
+
+// The modulus must be odd.
+void ModContext::halve(block_t* out, const block_t* a) const {
+    const std::size_t k = this->num_blocks;
+    block_t buf[k];
+    gear::copy(buf, a, k);
+    const bool carry = (a[0] & 1) ? gear::add(buf, k, this->modulus.ref_blocks(), k) : false;
+    for (std::size_t i = 0; i < k - 1; i++)
+        buf[i] = (buf[i] >> 1) | (buf[i+1] << (Integer::BlockBits - 1));
+    buf[k-1] = (buf[k-1] >> 1) | (static_cast<block_t>(carry) << (Integer::BlockBits - 1));
+    gear::copy(out, buf, k);
+}
+
+// e = 2^s + 1 such as 65537, which is the usual public exponent of RSA
+static int get_fermat_exponent_shift(const Integer& e) {
+    if (e.most_significant_active_bit() > Integer::BlockBits)
+        return 0;
+    const block_t e0 = e.ref_blocks()[0];
+    if (e0 < 3 || ((e0 - 1) & (e0 - 2)) != 0)
+        return 0;
+    return __builtin_ctzll(e0 - 1);
+}
+
+void ModContext::pow(block_t* out, const block_t* base, const Integer& e) const {
+    const std::size_t k = this->num_blocks;
+    const int exponent_bits = e.most_significant_active_bit();
+    if (exponent_bits == 0) {
+        set_one(out);
+        return;
+    }
+    if (this->limbs52.num > 0) {
+        // The base is converted from and the result to Montgomery form of 64-bit blocks.
+        block_t one[k];
+        one[0] = 1;
+        gear::fill_zero(&one[1], k - 1);
+        mul(out, base, one);
+        pow52(out, out, e);
+        mul(out, out, this->r2.ref_blocks());
+        return;
+    }
+
+    const bool lazy = can_reduce_lazily();
+    const block_t* m = this->modulus.ref_blocks();
+    const auto mul_step = [&](block_t* o, const block_t* a, const block_t* b) {
+        if (lazy)
+            gear::montgomery_mul_lazy(o, a, b, m, k, this->n0inv);
+        else
+            mul(o, a, b);
+    };
+    const auto square_step = [&](block_t* o, const block_t* a) {
+        if (lazy)
+            gear::montgomery_sqr_lazy(o, a, m, k, this->n0inv);
+        else
+            square(o, a);
+    };
+
+    block_t acc[k];
+    const int fermat_shift = get_fermat_exponent_shift(e);
+    if (fermat_shift > 0) {
+        // base^(2^s + 1) by s squarings and one multiplication without a table
+        gear::copy(acc, base, k);
+        for (int i = 0; i < fermat_shift; i++)
+            square_step(acc, acc);
+        mul_step(acc, acc, base);
+    } else {
+        // Fixed window method: table[i] = base^i
+        const int w = gear::choose_window_bits(exponent_bits);
+        const std::size_t table_size = 1 << w;
+        block_t table[table_size * k];
+        set_one(table);
+        gear::copy(&table[k], base, k);
+        for (std::size_t i = 2; i < table_size; i++)
+            mul_step(&table[i * k], &table[(i - 1) * k], base);
+
+        const block_t* e_blocks = e.ref_blocks();
+        const std::size_t num_e_blocks = e.get_num_blocks();
+        int pos = ((exponent_bits - 1) / w) * w;
+        const unsigned int top = gear::get_window(e_blocks, num_e_blocks, pos, exponent_bits - pos);
+        gear::copy(acc, &table[top * k], k);
+        while (pos > 0) {
+            pos -= w;
+            for (int i = 0; i < w; i++)
+                square_step(acc, acc);
+            const unsigned int v = gear::get_window(e_blocks, num_e_blocks, pos, w);
+            if (v != 0)
+                mul_step(acc, acc, &table[v * k]);
+        }
+    }
+
+    if (lazy && gear::compare(acc, m, k) >= 0)
+        gear::sub(acc, k, m, k);
+    gear::copy(out, acc, k);
+}
+
+// The same methods as pow() in Montgomery form of 52-bit limbs. The base and the result
+// are normal numbers less than the modulus.
+void ModContext::pow52(block_t* out, const block_t* base, const Integer& e) const {
+    const std::size_t k = this->num_blocks;
+    const Limbs52& limbs = this->limbs52;
+    const std::size_t num = limbs.num;
+    const std::size_t size = gear::get_limb52_buffer_size(num);
+    const auto mul52 = [&](block_t* o, const block_t* a, const block_t* b) {
+        gear::montgomery_mul52(o, a, b, limbs.n.data(), num, limbs.n0inv);
+    };
+
+    block_t one[size];
+    gear::fill_zero(one, size);
+    one[0] = 1;
+    block_t b[size];
+    gear::to_limbs52(b, size, base, k);
+    mul52(b, b, limbs.r2.data());
+
+    block_t acc[size];
+    const int exponent_bits = e.most_significant_active_bit();
+    const int fermat_shift = get_fermat_exponent_shift(e);
+    if (exponent_bits == 0) {
+        mul52(acc, one, limbs.r2.data());
+    } else if (fermat_shift > 0) {
+        gear::copy(acc, b, size);
+        for (int i = 0; i < fermat_shift; i++)
+            mul52(acc, acc, acc);
+        mul52(acc, acc, b);
+    } else {
+        const int w = gear::choose_window_bits(exponent_bits);
+        const std::size_t table_size = 1 << w;
+        block_t table[table_size * size];
+        mul52(table, one, limbs.r2.data());
+        gear::copy(&table[size], b, size);
+        for (std::size_t i = 2; i < table_size; i++)
+            mul52(&table[i * size], &table[(i - 1) * size], b);
+
+        const block_t* e_blocks = e.ref_blocks();
+        const std::size_t num_e_blocks = e.get_num_blocks();
+        int pos = ((exponent_bits - 1) / w) * w;
+        const unsigned int top = gear::get_window(e_blocks, num_e_blocks, pos, exponent_bits - pos);
+        gear::copy(acc, &table[top * size], size);
+        while (pos > 0) {
+            pos -= w;
+            for (int i = 0; i < w; i++)
+                mul52(acc, acc, acc);
+            const unsigned int v = gear::get_window(e_blocks, num_e_blocks, pos, w);
+            if (v != 0)
+                mul52(acc, acc, &table[v * size]);
+        }
+    }
+
+    mul52(acc, acc, one);
+    gear::from_limbs52(out, k, acc, num);
+    const block_t* m = this->modulus.ref_blocks();
+    if (gear::compare(out, m, k) >= 0)
+        gear::sub(out, k, m, k);
+}
+
+bool ModContext::is_small_base(const Integer& base) const {
+    const int msb = base.most_significant_active_bit();
+    return msb >= 2 && msb <= Integer::BlockBits && base.ref_blocks()[0] < SmallBaseLimit;
+}
+
+// r = r * b mod m by doublings and additions, where r < m.
+void ModContext::mul_small(block_t* r, const block_t b) const {
+    const std::size_t k = this->num_blocks;
+    const block_t* m = this->modulus.ref_blocks();
+    block_t a[k];
+    gear::copy(a, r, k);
+    for (int i = Integer::BlockBits - __builtin_clzll(b) - 2; i >= 0; i--) {
+        double_mod(r, m, k);
+        if ((b >> i) & 1)
+            add(r, r, a);
+    }
+}
+
+// Left-to-right binary method. Multiplications by the base are replaced with mul_small(),
+// which is much cheaper than Montgomery multiplication or Barrett reduction.
+void ModContext::pow_small_base(block_t* out, const block_t base, const Integer& e) const {
+    const std::size_t k = this->num_blocks;
+    const int exponent_bits = e.most_significant_active_bit();
+    if (exponent_bits == 0) {
+        set_one(out);
+        return;
+    }
+
+    const bool lazy = can_reduce_lazily();
+    const block_t* m = this->modulus.ref_blocks();
+    block_t acc[k];
+    set_one(acc);
+    mul_small(acc, base);
+    for (int b = exponent_bits - 2; b >= 0; b--) {
+        if (lazy)
+            gear::montgomery_sqr_lazy(acc, acc, m, k, this->n0inv);
+        else
+            square(acc, acc);
+
+        if (lazy && gear::compare(acc, m, k) >= 0)
+            gear::sub(acc, k, m, k);
+        if (e.get_bit_value(b))
+            mul_small(acc, base);
+    }
+    gear::copy(out, acc, k);
+}
+
+// Lazy reduction keeps residues less than 2m. It is safe when 4m < R.
+bool ModContext::can_reduce_lazily() const {
+    const block_t msb = this->modulus.ref_blocks()[this->num_blocks - 1];
+    return this->montgomery && (msb >> (Integer::BlockBits - 2)) == 0;
+}
+
+void ModContext::divide(block_t* q, block_t* r, const block_t* x, const std::size_t num_x) const {
+    if (this->montgomery)
+        throw std::invalid_argument("divide() needs Barrett reduction");
+    if (num_x > 2 * this->num_blocks)
+        throw std::invalid_argument("Too long dividend");
+    barrett_reduce(r, x, num_x, q);
+}
+
+// Barrett reduction (HAC Algorithm 14.42) of x with num_x <= 2k blocks. x / b^(k-1) has
+// j + 1 blocks, where j = num_x - k, and only the upper j + 2 blocks of mu are needed for
+// q3. The dropped blocks make q3 smaller by one at most. The quotient of j + 1 blocks is
+// also stored in q unless it is nullptr.
+void ModContext::barrett_reduce(block_t* out, const block_t* x, const std::size_t num_x,
+                                block_t* q) const {
+    const std::size_t k = this->num_blocks;
+    const block_t* m = this->modulus.ref_blocks();
+    if (num_x < k) {
+        // x < b^(k-1) <= m
+        gear::copy(out, x, num_x);
+        gear::fill_zero(&out[num_x], k - num_x);
+        if (q)
+            q[0] = 0;
+        return;
+    }
+
+    const std::size_t j = num_x - k;
+    const std::size_t num_mu = std::min(j + 2, k + 1);
+    const block_t* q1 = &x[k - 1];
+    block_t q2[j + 1 + num_mu];
+    gear::karatsuba(q2, j + 1 + num_mu, q1, j + 1, &this->mu.ref_blocks()[k + 1 - num_mu], num_mu);
+    block_t* q3 = &q2[num_mu];
+
+    block_t q3m[k + j + 1];
+    gear::karatsuba(q3m, k + j + 1, q3, j + 1, m, k);
+
+    // r = (x - q3 * m) mod b^(k+1)
+    const std::size_t num_r = std::min(num_x, k + 1);
+    const block_t one = 1;
+    block_t r[k + 1];
+    gear::copy(r, x, num_r);
+    gear::fill_zero(&r[num_r], k + 1 - num_r);
+    gear::sub(r, k + 1, q3m, k + 1);
+    while (r[k] != 0 || gear::compare(r, m, k) >= 0) {
+        gear::sub(r, k + 1, m, k);
+        if (q)
+            gear::add(q3, j + 1, &one, 1);
+    }
+    gear::copy(out, r, k);
+    if (q)
+        gear::copy(q, q3, j + 1);
+}
+
+//
+// ModInteger
+//
+static Integer create_residue(const Integer& n, const ModContext& context) {
+    block_t buf[context.get_num_blocks()];
+    context.to_internal(buf, n);
+    return Integer::from_blocks(buf, context.get_num_blocks());
+}
+
+ModInteger::ModInteger(const Integer& n, const std::shared_ptr<const ModContext>& ctx)
+: context(ctx),
+  value(create_residue(n, *ctx)) {
+}
+
+ModInteger::ModInteger(const block_t* blocks, const std::shared_ptr<const ModContext>& ctx)
+: context(ctx),
+  value(Integer::from_blocks(blocks, ctx->get_num_blocks())) {
+}
+
+ModInteger& ModInteger::operator=(const ModInteger& n) {
+    this->context = n.context;
+    this->value = Integer(n.value);
+    return *this;
+}
+
+Integer ModInteger::to_Integer() const {
+    return this->context->to_Integer(this->value.ref_blocks());
+}
+
+std::ostream& operator<<(std::ostream& os, const ModInteger& n) {
+    os << n.to_Integer();
+    return os;
+}
+
+ModInteger ModInteger::operator+(const ModInteger& r) const {
+    check_context(r);
+    block_t buf[this->context->get_num_blocks()];
+    this->context->add(buf, this->value.ref_blocks(), r.value.ref_blocks());
+    return ModInteger(buf, this->context);
+}
+
+ModInteger ModInteger::operator-(const ModInteger& r) const {
+    check_context(r);
+    block_t buf[this->context->get_num_blocks()];
+    this->context->sub(buf, this->value.ref_blocks(), r.value.ref_blocks());
+    return ModInteger(buf, this->context);
+}
+
+ModInteger ModInteger::operator*(const ModInteger& r) const {
+    check_context(r);
+    block_t buf[this->context->get_num_blocks()];
+    this->context->mul(buf, this->value.ref_blocks(), r.value.ref_blocks());
+    return ModInteger(buf, this->context);
+}
+
+ModInteger& ModInteger::operator+=(const ModInteger& r) {
+    return *this = (*this) + r;
+}
+
+ModInteger& ModInteger::operator-=(const ModInteger& r) {
+    return *this = (*this) - r;
+}
+
+ModInteger& ModInteger::operator*=(const ModInteger& r) {
+    return *this = (*this) * r;
+}
+
+bool ModInteger::operator==(const ModInteger& r) const {
+    check_context(r);
+    const std::size_t k = this->context->get_num_blocks();
+    return gear::compare(this->value.ref_blocks(), r.value.ref_blocks(), k) == 0;
+}
+
+bool ModInteger::operator!=(const ModInteger& r) const {
+    return !((*this) == r);
+}
+
+ModInteger ModInteger::square() const {
+    block_t buf[this->context->get_num_blocks()];
+    this->context->square(buf, this->value.ref_blocks());
+    return ModInteger(buf, this->context);
+}
+
+ModInteger ModInteger::halve() const {
+    block_t buf[this->context->get_num_blocks()];
+    this->context->halve(buf, this->value.ref_blocks());
+    return ModInteger(buf, this->context);
+}
+
+ModInteger ModInteger::pow(const Integer& e) const {
+    block_t buf[this->context->get_num_blocks()];
+    this->context->pow(buf, this->value.ref_blocks(), e);
+    return ModInteger(buf, this->context);
+}
+
+ModInteger ModInteger::pow(const Integer& base, const Integer& e,
+                           const std::shared_ptr<const ModContext>& context) {
+    block_t buf[context->get_num_blocks()];
+    context->pow(buf, base, e);
+    return ModInteger(buf, context);
+}
+
+ModInteger ModInteger::inverse() const {
+    return ModInteger(to_Integer().inverse(this->context->get_modulus()), this->context);
+}
+
+void ModInteger::check_context(const ModInteger& r) const {
+    if (this->context == r.context)
+        return;
+    if (this->context->get_modulus() != r.context->get_modulus())
+        throw std::invalid_argument("ModInteger: different modulus");
+    if (this->context->is_montgomery() != r.context->is_montgomery())
+        throw std::invalid_argument("ModInteger: different representation");
+}
+
+} // namespace grill
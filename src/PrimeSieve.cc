@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include "PrimeSieve.h"
+
+namespace grill {
+
+using block_t = PrimeSieve::block_t;
+
+// The wheel of 2 * 3 * 5 * 7 = 210. The k-th element tells whether the odd number
+// 2k + 1 (mod 210) is a multiple of 3, 5 or 7. The pattern is repeated over a segment,
+// so a segment is initialized by one copy from the position of its first number.
+static constexpr std::size_t WheelSize = 105;
+
+static const std::vector<uint8_t>& get_wheel() {
+    static const std::vector<uint8_t> wheel = [] {
+        std::vector<uint8_t> w(PrimeSieve::SegmentSize + WheelSize);
+        for (std::size_t k = 0; k < w.size(); k++) {
+            const std::size_t v = 2 * k + 1;
+            w[k] = (v % 3 == 0 || v % 5 == 0 || v % 7 == 0);
+        }
+        return w;
+    }();
+    return wheel;
+}
+
+// The primes from 11, which is the 5th prime, are sieved by the segments.
+static constexpr std::size_t FirstSievingPrimeIndex = 4;
+
+static block_t isqrt(const block_t n) {
+    constexpr block_t Max = 0xffff'ffff;
+    block_t r = std::min<block_t>(std::sqrt(static_cast<long double>(n)), Max);
+    while (r * r > n)
+        r--;
+    while (r < Max && (r + 1) * (r + 1) <= n)
+        r++;
+    return r;
+}
+
+//
+// The process-wide table of small primes
+//
+// The initial table is made by a plain sieve. It is extended by PrimeSieve, whose sieving
+// primes are already in the table. The vector is reserved for all the primes less than
+// SmallPrimeTableLimit, so it is extended in place and the returned spans stay valid.
+static constexpr block_t InitialTableLimit = 1 << 16;
+static constexpr std::size_t MaxNumSmallPrimes = 1'077'871; // pi(SmallPrimeTableLimit)
+
+struct SmallPrimeTable {
+    std::mutex mutex;
+    std::vector<block_t> primes;
+    block_t limit = InitialTableLimit;
+
+    SmallPrimeTable() {
+        this->primes.reserve(MaxNumSmallPrimes);
+        std::vector<bool> composite(InitialTableLimit, false);
+        for (block_t i = 2; i < InitialTableLimit; i++) {
+            if (composite[i])
+                continue;
+            this->primes.emplace_back(i);
+            for (block_t j = i * i; j < InitialTableLimit; j += i)
+                composite[j] = true;
+        }
+    }
+
+    static SmallPrimeTable& get_instance() {
+        static SmallPrimeTable instance;
+        return instance;
+    }
+};
+
+std::span<const block_t> PrimeSieve::get_small_primes(const block_t limit) {
+    if (limit > SmallPrimeTableLimit)
+        throw std::invalid_argument("limit must not be over SmallPrimeTableLimit");
+
+    auto& table = SmallPrimeTable::get_instance();
+    while (true) {
+        block_t table_limit;
+        {
+            std::lock_guard<std::mutex> lock(table.mutex);
+            if (limit <= table.limit)
+                return std::span<const block_t>(table.primes.data(), table.primes.size());
+            table_limit = table.limit;
+        }
+
+        // The table is at least doubled. The sieving primes of the new range are less than
+        // 2^12, so they are in the initial table.
+        const block_t new_limit = std::min(std::max(limit, table_limit * 2), SmallPrimeTableLimit);
+
+        // The new primes are sieved without the lock because it can take a long time, and
+        // only they are appended under the lock.
+        const std::vector<block_t> new_primes = get_primes(table_limit, new_limit);
+        std::lock_guard<std::mutex> lock(table.mutex);
+        if (table.limit == table_limit) {
+            table.primes.insert(table.primes.end(), new_primes.begin(), new_primes.end());
+            table.limit = new_limit;
+        }
+    }
+}
+
+//
+// PrimeSieve
+//
+PrimeSieve::iterator::iterator(PrimeSieve* sieve)
+: sieve(sieve) {
+    if (this->sieve != nullptr)
+        this->next();
+}
+
+void PrimeSieve::iterator::next() {
+    const std::optional<block_t> p = this->sieve->next();
+    if (p)
+        this->value = *p;
+    else
+        this->sieve = nullptr;
+}
+
+PrimeSieve::PrimeSieve(const block_t from, const block_t to)
+: from(from),
+  to(to),
+  composite(SegmentSize + sizeof(uint64_t)) {
+    this->restart();
+}
+
+PrimeSieve::iterator PrimeSieve::begin() {
+    this->restart();
+    return iterator(this);
+}
+
+PrimeSieve::iterator PrimeSieve::end() {
+    return iterator(nullptr);
+}
+
+std::optional<block_t> PrimeSieve::next() {
+    if (this->two_pending) {
+        this->two_pending = false;
+        return 2;
+    }
+    // The flags are scanned by 8 bytes. A flag is 0 or 1, so a bit of ~word & LowBits is set
+    // at every prime in the word.
+    constexpr uint64_t LowBits = 0x0101'0101'0101'0101;
+    while (true) {
+        if (this->word_mask != 0) {
+            const std::size_t i = this->word_pos + __builtin_ctzll(this->word_mask) / 8;
+            this->word_mask &= this->word_mask - 1;
+            return this->low + 2 * i;
+        }
+        if (this->pos < this->size) {
+            uint64_t word;
+            std::memcpy(&word, &this->composite[this->pos], sizeof(word));
+            this->word_mask = ~word & LowBits;
+            this->word_pos = this->pos;
+            this->pos += sizeof(word);
+            continue;
+        }
+        if (this->last_segment)
+            return std::nullopt;
+        this->fill_segment(this->next_low);
+    }
+}
+
+std::vector<block_t> PrimeSieve::get_primes(const block_t from, const block_t to) {
+    std::vector<block_t> primes;
+    for (const block_t p: PrimeSieve(from, to))
+        primes.emplace_back(p);
+    return primes;
+}
+
+void PrimeSieve::restart() {
+    this->two_pending = (this->from <= 2 && 2 < this->to);
+    this->next_low = (this->from <= 1) ? 1 : (this->from | 1);
+    this->size = 0;
+    this->pos = 0;
+    this->word_mask = 0;
+    this->last_segment = (this->next_low >= this->to);
+    this->next_offsets.clear();
+}
+
+void PrimeSieve::fill_segment(const block_t seg_low) {
+    const block_t num_remaining = (this->to - seg_low + 1) / 2;
+    this->low = seg_low;
+    this->size = std::min<block_t>(num_remaining, SegmentSize);
+    this->pos = 0;
+    this->last_segment = (num_remaining <= SegmentSize);
+    if (!this->last_segment)
+        this->next_low = seg_low + 2 * this->size;
+
+    // The multiples of 3, 5 and 7 are removed by the wheel.
+    const auto& wheel = get_wheel();
+    const std::size_t k = (seg_low % (2 * WheelSize)) / 2;
+    std::copy(wheel.begin() + k, wheel.begin() + k + this->size, this->composite.begin());
+    std::fill(this->composite.begin() + this->size, this->composite.end(), true); // Padding
+    if (seg_low <= 7) {
+        for (const block_t p: {3, 5, 7}) {
+            if (p >= seg_low && (p - seg_low) / 2 < this->size)
+                this->composite[(p - seg_low) / 2] = false;
+        }
+        if (seg_low == 1)
+            this->composite[0] = true;
+    }
+
+    const block_t high = seg_low + 2 * (this->size - 1);
+    const block_t sqrt_high = isqrt(high);
+    const std::span<const block_t> primes = this->get_sieving_primes(sqrt_high + 1);
+    for (std::size_t k = FirstSievingPrimeIndex; k < primes.size(); k++) {
+        const block_t p = primes[k];
+        if (p > sqrt_high)
+            break;
+
+        // The index is carried over from the previous segment. Otherwise it is the first
+        // index i such that seg_low + 2i is an odd multiple of p and not less than p^2.
+        // seg_low + 2i = 0 (mod p) => i = -seg_low * 2^-1 (mod p), where 2^-1 = (p + 1) / 2
+        const std::size_t offset_idx = k - FirstSievingPrimeIndex;
+        if (offset_idx == this->next_offsets.size()) {
+            if (p * p >= seg_low)
+                this->next_offsets.emplace_back((p * p - seg_low) / 2);
+            else
+                this->next_offsets.emplace_back((p - seg_low % p) % p * ((p + 1) / 2) % p);
+        }
+        std::size_t i = this->next_offsets[offset_idx];
+        for (; i < this->size; i += p)
+            this->composite[i] = true;
+        this->next_offsets[offset_idx] = i - this->size;
+    }
+}
+
+std::span<const block_t> PrimeSieve::get_sieving_primes(const block_t limit) {
+    if (limit <= SmallPrimeTableLimit)
+        return get_small_primes(limit);
+
+    // The range is over SmallPrimeTableLimit^2. The primes over the table are sieved for
+    // this instance, and they are released with it.
+    if (this->own_sieving_primes.empty()) {
+        const std::span<const block_t> table = get_small_primes(SmallPrimeTableLimit);
+        this->own_sieving_primes.assign(table.begin(), table.end());
+        this->own_sieving_limit = SmallPrimeTableLimit;
+    }
+    if (this->own_sieving_limit < limit) {
+        const block_t max_limit = isqrt(this->to - 1) + 1;
+        const block_t doubled = (this->own_sieving_limit > max_limit / 2) ?
+                                max_limit : this->own_sieving_limit * 2;
+        const block_t new_limit = std::min(std::max(limit, doubled), max_limit);
+        for (const block_t p: PrimeSieve(this->own_sieving_limit, new_limit))
+            this->own_sieving_primes.emplace_back(p);
+        this->own_sieving_limit = new_limit;
+    }
+    return this->own_sieving_primes;
+}
+
+} // namespace grill
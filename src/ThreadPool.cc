@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include "ThreadPool.h"
+
+namespace grill {
+
+ThreadPool::ThreadPool(const std::size_t num_threads) {
+    const std::size_t n = resolve_num_threads(num_threads);
+    for (std::size_t i = 0; i < n; i++)
+        this->workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->cond.notify_all();
+    for (auto& th: this->workers)
+        th.join();
+}
+
+// Each worker takes the indices one by one, so the calls of different costs are balanced.
+void ThreadPool::run(const std::size_t n, const std::function<void(const std::size_t)>& f) {
+    const std::size_t num_tasks = std::min(n, this->get_num_threads());
+    std::atomic<std::size_t> next_index(0);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    std::vector<std::future<void>> futures;
+    for (std::size_t t = 0; t < num_tasks; t++) {
+        futures.emplace_back(this->submit([&] {
+            for (std::size_t i = next_index++; i < n; i = next_index++) {
+                try {
+                    f(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        }));
+    }
+    for (auto& future: futures)
+        future.wait();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+std::size_t ThreadPool::resolve_num_threads(const std::size_t num_threads) {
+    if (num_threads != 0)
+        return num_threads;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::push(std::function<void()>&& task) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->tasks.emplace(std::move(task));
+    }
+    this->cond.notify_one();
+}
+
+void ThreadPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->cond.wait(lock, [this] {
+                return this->stopping || !this->tasks.empty();
+            });
+            if (this->tasks.empty())
+                return;
+            task = std::move(this->tasks.front());
+            this->tasks.pop();
+        }
+        task();
+    }
+}
+
+} // namespace grill
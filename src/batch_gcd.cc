@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "constant.h"
+#include "ModInteger.h"
+#include "util.h"
+#include "ThreadPool.h"
+#include "batch_gcd.h"
+
+namespace grill {
+
+using block_t = Integer::block_t;
+
+static std::size_t calc_num_blocks(const int bits) {
+    return std::max(1, (bits + Integer::BlockBits - 1) / Integer::BlockBits);
+}
+
+// x in the blocks of the given bits. The upper blocks are dropped.
+static Integer resize(const Integer& x, const int bits) {
+    return Integer::from_blocks(x.ref_blocks(), x.get_num_blocks(), calc_num_blocks(bits));
+}
+
+static Integer shift_left(const Integer& x, const int bits) {
+    Integer y = resize(x, x.most_significant_active_bit() + bits);
+    y <<= bits;
+    return y;
+}
+
+static Integer shift_right(const Integer& x, const int bits) {
+    const int num_bits = x.most_significant_active_bit() - bits;
+    if (num_bits <= 0)
+        return constant::Zero;
+    Integer y(x);
+    y >>= bits;
+    return resize(y, num_bits);
+}
+
+// x mod 2^bits
+static Integer truncate(const Integer& x, const int bits) {
+    if (x.most_significant_active_bit() <= bits)
+        return x;
+    const std::size_t num_blocks = calc_num_blocks(bits);
+    std::vector<block_t> blocks(x.ref_blocks(), x.ref_blocks() + num_blocks);
+    if (bits % Integer::BlockBits != 0)
+        blocks[num_blocks - 1] &= (block_t(1) << (bits % Integer::BlockBits)) - 1;
+    return Integer::from_blocks(blocks.data(), num_blocks);
+}
+
+static Integer pow2(const int e) {
+    Integer x(constant::Zero);
+    x.set_bit_value(e, true);
+    return x;
+}
+
+// The fraction of x / m is calculated with this many extra bits.
+static constexpr int GuardBits = 64;
+
+//
+// Product tree and remainder tree
+//
+static batch_gcd::ProductTree build_tree(const std::vector<Integer>& leaves, ThreadPool& pool) {
+    if (leaves.empty())
+        throw std::invalid_argument("No leaves");
+    for (const Integer& leaf: leaves) {
+        if (leaf.is_zero())
+            throw std::invalid_argument("A leaf must not be zero");
+    }
+
+    batch_gcd::ProductTree tree;
+    tree.emplace_back(leaves);
+    while (tree.back().size() > 1) {
+        const std::vector<Integer>& lower = tree.back();
+        std::vector<Integer> upper((lower.size() + 1) / 2, constant::Zero);
+        pool.run(upper.size(), [&](const std::size_t i) {
+            const std::size_t left = 2 * i;
+            upper[i] = (left + 1 < lower.size()) ? lower[left] * lower[left + 1]
+                                                 : Integer(lower[left]);
+        });
+        tree.emplace_back(std::move(upper));
+    }
+    return tree;
+}
+
+batch_gcd::ProductTree batch_gcd::build_product_tree(const std::vector<Integer>& leaves,
+                                                     const std::size_t num_threads) {
+    ThreadPool pool(num_threads);
+    return build_tree(leaves, pool);
+}
+
+// A fraction t in [0, 1) is represented by floor(t * 2^precision).
+struct Fraction {
+    Integer value;
+    int precision;
+};
+
+// floor(x * 2^precision / m) mod 2^precision, where m is the modulus of the context. x is
+// reduced by the context, and the remainder r is scaled in pieces of fewer bits than m, so
+// that r * 2^shift has 2k blocks at most as ModContext::divide() requires. The last piece
+// is short and its division is cheap.
+static Integer calc_fraction(const Integer& x, const ModContext& context, const int precision) {
+    const std::size_t k = context.get_num_blocks();
+    const int piece_bits = std::max(1, context.get_modulus().most_significant_active_bit() - 1);
+    std::vector<block_t> r(k);
+    context.reduce(r.data(), x);
+    Integer fraction(constant::Zero);
+    for (int bits = precision; bits > 0; bits -= piece_bits) {
+        const int shift = std::min(bits, piece_bits);
+        const Integer dividend = shift_left(Integer::from_blocks(r.data(), k), shift);
+        const std::size_t num_dividend = dividend.get_num_blocks();
+        std::vector<block_t> q(std::max(num_dividend, k) - k + 1);
+        context.divide(q.data(), r.data(), dividend.ref_blocks(), num_dividend);
+        fraction = shift_left(fraction, shift) + Integer::from_blocks(q.data(), q.size());
+    }
+    return fraction;
+}
+
+// A child loses two bits of the precision at most. So two bits for each level are added
+// to the precision of the root.
+static int calc_root_precision(const batch_gcd::ProductTree& tree) {
+    return 2 * tree.back().front().most_significant_active_bit() + GuardBits + 2 * tree.size();
+}
+
+// Barrett reduction is used for a root and its square. Montgomery representation costs
+// much more to set up for such a large modulus.
+static std::unique_ptr<const ModContext> create_context(const Integer& modulus) {
+    return std::make_unique<const ModContext>(modulus, ModContext::Reduction::Barrett);
+}
+
+// Bernstein's scaled remainder tree: the fractional part of x / node^2 is calculated for
+// each node. That of a child is the fractional part of that of its parent multiplied by
+// the square of its sibling. So x is divided only at the root, and the other nodes need
+// one multiplication each instead of a division.
+static std::vector<Fraction> calc_leaf_fractions(const Fraction& root_fraction,
+                                                 const batch_gcd::ProductTree& tree,
+                                                 ThreadPool& pool) {
+    std::vector<Fraction> fractions = {root_fraction};
+    for (std::size_t level = tree.size() - 1; level > 0; level--) {
+        const std::vector<Integer>& nodes = tree[level - 1];
+        std::vector<Fraction> lower_fractions(nodes.size(), Fraction {constant::Zero, 0});
+        pool.run(nodes.size(), [&](const std::size_t i) {
+            const Fraction& upper = fractions[i / 2];
+            Fraction& lower = lower_fractions[i];
+            const std::size_t sibling = i ^ 1;
+            if (sibling >= nodes.size()) {
+                // The node is carried up as it is.
+                lower.value = Integer(upper.value);
+                lower.precision = upper.precision;
+                return;
+            }
+            const Integer square = nodes[sibling] * nodes[sibling];
+            const int shift = 2 * nodes[sibling].most_significant_active_bit();
+            lower.precision = upper.precision - shift;
+            lower.value = truncate(shift_right(upper.value * square, shift), lower.precision);
+        });
+        fractions = std::move(lower_fractions);
+    }
+    return fractions;
+}
+
+// Returns round(t * m) mod m, where t is the fraction. It is x mod m if t is the fractional
+// part of x / m with enough precision.
+static Integer calc_residue(const Fraction& t, const Integer& m) {
+    const Integer r = shift_right(t.value * m + pow2(t.precision - 1), t.precision);
+    return (r == m) ? constant::Zero : r;
+}
+
+std::vector<Integer> batch_gcd::calc_remainders(const Integer& x, const ProductTree& tree,
+                                                const std::size_t num_threads) {
+    ThreadPool pool(num_threads);
+    const Integer& root = tree.back().front();
+    const int precision = calc_root_precision(tree);
+    const Fraction root_fraction = {calc_fraction(x, *create_context(root * root), precision),
+                                    precision};
+    const std::vector<Fraction> fractions = calc_leaf_fractions(root_fraction, tree, pool);
+    const std::vector<Integer>& leaves = tree.front();
+    std::vector<Integer> remainders(leaves.size(), constant::Zero);
+    pool.run(leaves.size(), [&](const std::size_t i) {
+        remainders[i] = calc_residue(fractions[i], leaves[i] * leaves[i]);
+    });
+    return remainders;
+}
+
+//
+// Tree files for the streaming mode
+//
+static std::string get_tree_path(const std::string& work_dir, const std::size_t group) {
+    std::stringstream ss;
+    ss << work_dir << "/batch-gcd-" << group << ".tree";
+    return ss.str();
+}
+
+static void write_size(std::ostream& os, const std::size_t n) {
+    os.write(reinterpret_cast<const char*>(&n), sizeof(n));
+}
+
+static std::size_t read_size(std::istream& is) {
+    std::size_t n;
+    is.read(reinterpret_cast<char*>(&n), sizeof(n));
+    return n;
+}
+
+static void save_tree(const std::string& path, const batch_gcd::ProductTree& tree) {
+    std::ofstream ofs(path, std::ios::binary);
+    write_size(ofs, tree.size());
+    for (const auto& nodes: tree) {
+        write_size(ofs, nodes.size());
+        for (const Integer& node: nodes) {
+            write_size(ofs, node.get_num_blocks());
+            ofs.write(reinterpret_cast<const char*>(node.ref_blocks()),
+                      sizeof(Integer::block_t) * node.get_num_blocks());
+        }
+    }
+    if (!ofs)
+        throw std::runtime_error("Failed to write: " + path);
+}
+
+static batch_gcd::ProductTree load_tree(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+    batch_gcd::ProductTree tree(read_size(ifs));
+    for (auto& nodes: tree) {
+        const std::size_t num_nodes = read_size(ifs);
+        for (std::size_t i = 0; i < num_nodes && ifs; i++) {
+            std::vector<block_t> blocks(read_size(ifs));
+            ifs.read(reinterpret_cast<char*>(blocks.data()), sizeof(block_t) * blocks.size());
+            nodes.emplace_back(Integer::from_blocks(blocks.data(), blocks.size()));
+        }
+    }
+    if (!ifs)
+        throw std::runtime_error("Failed to read: " + path);
+    return tree;
+}
+
+//
+// Batch GCD
+//
+// The contexts of R_i^2 for each group i, or that of R_0 if there is only one group
+using RootContexts = std::vector<std::unique_ptr<const ModContext>>;
+
+// The product of the roots modulo R_i^2 for each group i
+static std::vector<Integer> calc_root_products(const std::vector<Integer>& roots,
+                                               const RootContexts& contexts,
+                                               ThreadPool& pool) {
+    if (roots.size() == 1)
+        return roots;
+
+    std::vector<Integer> products(roots.size(), constant::Zero);
+    pool.run(roots.size(), [&](const std::size_t i) {
+        const ModContext& context = *contexts[i];
+        std::vector<block_t> buf(context.get_num_blocks());
+        Integer product(constant::One);
+        for (const Integer& root: roots) {
+            context.reduce(buf.data(), product * root);
+            product = Integer::from_blocks(buf.data(),
+                                           gear::get_num_active_blocks(buf.data(), buf.size()));
+        }
+        products[i] = std::move(product);
+    });
+    return products;
+}
+
+std::vector<Integer> batch_gcd::calc(const std::vector<Integer>& moduli, const Options& options) {
+    if (moduli.empty())
+        return {};
+    if (options.group_size == 0)
+        throw std::invalid_argument("group_size must be greater than 0");
+
+    const std::size_t num_groups = (moduli.size() + options.group_size - 1) / options.group_size;
+    const bool streaming = !options.work_dir.empty();
+    ThreadPool pool(options.num_threads);
+    std::vector<ProductTree> trees;
+    std::vector<Integer> roots;
+    for (std::size_t g = 0; g < num_groups; g++) {
+        const auto first = moduli.begin() + g * options.group_size;
+        const auto last = moduli.begin() + std::min(moduli.size(), (g + 1) * options.group_size);
+        ProductTree tree = build_tree(std::vector<Integer>(first, last), pool);
+        roots.emplace_back(tree.back().front());
+        if (streaming)
+            save_tree(get_tree_path(options.work_dir, g), tree);
+        else
+            trees.emplace_back(std::move(tree));
+    }
+
+    // With only one group, P / R^2 = 1 / R, which needs the context of R instead of R^2.
+    RootContexts root_contexts(num_groups);
+    pool.run(num_groups, [&](const std::size_t g) {
+        root_contexts[g] = create_context((num_groups > 1) ? roots[g] * roots[g] : roots[g]);
+    });
+    const std::vector<Integer> root_products = calc_root_products(roots, root_contexts, pool);
+    std::vector<Integer> gcds;
+    for (std::size_t g = 0; g < num_groups; g++) {
+        const ProductTree tree = streaming ? load_tree(get_tree_path(options.work_dir, g))
+                                           : std::move(trees[g]);
+        const std::vector<Integer>& leaves = tree.front();
+        const int precision = calc_root_precision(tree);
+        const Integer& x = (num_groups > 1) ? root_products[g] : constant::One;
+        const Fraction root_fraction = {calc_fraction(x, *root_contexts[g], precision), precision};
+        const std::vector<Fraction> fractions = calc_leaf_fractions(root_fraction, tree, pool);
+
+        std::vector<Integer> group_gcds(leaves.size(), constant::Zero);
+        pool.run(leaves.size(), [&](const std::size_t i) {
+            // (P mod N^2) / N = (P / N) mod N because N divides P. It is the fractional part
+            // of P / N^2 multiplied by N.
+            const Integer& n = leaves[i];
+            group_gcds[i] = util::gcd(calc_residue(fractions[i], n), n);
+        });
+        for (Integer& x: group_gcds)
+            gcds.emplace_back(std::move(x));
+        if (streaming)
+            std::remove(get_tree_path(options.work_dir, g).c_str());
+    }
+    return gcds;
+}
+
+} // namespace grill
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include "constant.h"
+#include "gear.h"
+#include "ModInteger.h"
+#include "batch_pow_mod.h"
+
+namespace grill {
+namespace batch_pow_mod {
+
+using block_t = Integer::block_t;
+
+static constexpr block_t LimbMask = (static_cast<block_t>(1) << gear::Limb52Bits) - 1;
+
+template<typename T>
+static const T& get_element(std::span<const T> v, const std::size_t i) {
+    return v[(v.size() == 1) ? 0 : i];
+}
+
+Backend get_backend() {
+    return gear::is_ifma_supported() ? Backend::Avx512Ifma : Backend::Scalar;
+}
+
+//
+// Lanes
+//
+// The limbs of the lanes are interleaved: limbs[j * NumLanes + lane] is the j-th limb
+// of the lane. The Montgomery multiplication is the almost Montgomery multiplication,
+// whose inputs and output are less than 2n, with R = 2^(52 * num).
+#if defined(__x86_64__)
+// The masked shifts are used because the unmasked ones trigger -Wmaybe-uninitialized of GCC.
+static constexpr __mmask8 AllLanes = 0xff;
+
+// out = a * b * R^-1 mod n for each lane. `out` may be the same as `a` or `b`.
+//
+// The partial products are accumulated in 64-bit elements without carries, and only
+// the carry of the limb eliminated by u * n is propagated in the loop. An element gets
+// at most 4 * num products of 52 bits, so it doesn't overflow for gear::MaxNumLimbs52.
+__attribute__((target("avx512f,avx512ifma")))
+static void mul_lanes(block_t* out, const block_t* a, const block_t* b, const block_t* n,
+                      const block_t* k0, const std::size_t num) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i k0v = _mm512_loadu_si512(k0);
+    __m512i t[2 * gear::MaxNumLimbs52];
+    for (std::size_t i = 0; i < 2 * num; i++)
+        t[i] = zero;
+
+    for (std::size_t i = 0; i < num; i++) {
+        const __m512i bi = _mm512_loadu_si512(&b[i * NumLanes]);
+        for (std::size_t j = 0; j < num; j++) {
+            const __m512i aj = _mm512_loadu_si512(&a[j * NumLanes]);
+            t[i + j] = _mm512_madd52lo_epu64(t[i + j], aj, bi);
+            t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], aj, bi);
+        }
+        const __m512i u = _mm512_madd52lo_epu64(zero, t[i], k0v);
+        for (std::size_t j = 0; j < num; j++) {
+            const __m512i nj = _mm512_loadu_si512(&n[j * NumLanes]);
+            t[i + j] = _mm512_madd52lo_epu64(t[i + j], nj, u);
+            t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], nj, u);
+        }
+        const __m512i carry = _mm512_maskz_srli_epi64(AllLanes, t[i], gear::Limb52Bits);
+        t[i + 1] = _mm512_add_epi64(t[i + 1], carry);
+    }
+
+    const __m512i mask = _mm512_set1_epi64(LimbMask);
+    __m512i carry = zero;
+    for (std::size_t i = 0; i < num; i++) {
+        const __m512i x = _mm512_add_epi64(t[num + i], carry);
+        _mm512_storeu_si512(&out[i * NumLanes], _mm512_and_si512(x, mask));
+        carry = _mm512_maskz_srli_epi64(AllLanes, x, gear::Limb52Bits);
+    }
+}
+#else
+static void mul_lanes(block_t*, const block_t*, const block_t*, const block_t*,
+                      const block_t*, const std::size_t) {
+    throw std::logic_error("AVX-512 IFMA is not available");
+}
+#endif
+
+// The exponentiations of `indices`, whose contexts have `num` limbs. The unused lanes
+// repeat the last one. The limbs of the moduli and R^2 are precomputed by the contexts.
+static void calc_lanes(std::span<const Integer> bases, std::span<const Integer> exponents,
+                       std::span<const ModContext* const> contexts,
+                       const std::vector<std::size_t>& indices, const std::size_t num,
+                       std::vector<Integer>& results) {
+    const std::size_t size = num * NumLanes;
+    std::vector<block_t> n(size), r2(size), base(size), one(size, 0);
+    std::array<block_t, NumLanes> k0;
+    std::array<const Integer*, NumLanes> e;
+    int exponent_bits = 0;
+    for (std::size_t lane = 0; lane < NumLanes; lane++) {
+        const std::size_t i = indices[std::min(lane, indices.size() - 1)];
+        const ModContext& context = *get_element(contexts, i);
+        const ModContext::Limbs52& limbs = *context.get_limbs52();
+        for (std::size_t j = 0; j < num; j++) {
+            n[j * NumLanes + lane] = limbs.n[j];
+            r2[j * NumLanes + lane] = limbs.r2[j];
+        }
+        std::vector<block_t> reduced(context.get_num_blocks());
+        context.reduce(reduced.data(), bases[i]);
+        gear::to_limbs52(&base[lane], num, reduced.data(), reduced.size(), NumLanes);
+        k0[lane] = limbs.n0inv;
+        one[lane] = 1;
+        e[lane] = &get_element(exponents, i);
+        exponent_bits = std::max(exponent_bits, e[lane]->most_significant_active_bit());
+    }
+
+    const auto mul = [&](block_t* out, const block_t* a, const block_t* b) {
+        mul_lanes(out, a, b, n.data(), k0.data(), num);
+    };
+
+    // Fixed window method: table[v] = base^v in Montgomery form
+    const int w = gear::choose_window_bits(exponent_bits);
+    const std::size_t table_size = 1 << w;
+    std::vector<block_t> table(table_size * size);
+    mul(&table[0], one.data(), r2.data());
+    mul(&table[size], base.data(), r2.data());
+    for (std::size_t v = 2; v < table_size; v++)
+        mul(&table[v * size], &table[(v - 1) * size], &table[size]);
+
+    // Each lane picks its own table entry.
+    std::vector<block_t> acc(size), operand(size);
+    const auto gather = [&](block_t* out, const int pos, const int width) {
+        bool is_all_zero = true;
+        for (std::size_t lane = 0; lane < NumLanes; lane++) {
+            const unsigned int v =
+              gear::get_window(e[lane]->ref_blocks(), e[lane]->get_num_blocks(), pos, width);
+            is_all_zero &= (v == 0);
+            for (std::size_t j = 0; j < num; j++)
+                out[j * NumLanes + lane] = table[v * size + j * NumLanes + lane];
+        }
+        return is_all_zero;
+    };
+
+    int pos = (exponent_bits > 0) ? ((exponent_bits - 1) / w) * w : 0;
+    gather(acc.data(), pos, exponent_bits - pos);
+    while (pos > 0) {
+        pos -= w;
+        for (int i = 0; i < w; i++)
+            mul(acc.data(), acc.data(), acc.data());
+        if (!gather(operand.data(), pos, w))
+            mul(acc.data(), acc.data(), operand.data());
+    }
+    // The product with one is not greater than n.
+    mul(acc.data(), acc.data(), one.data());
+
+    for (std::size_t lane = 0; lane < indices.size(); lane++) {
+        const std::size_t i = indices[lane];
+        const ModContext& context = *get_element(contexts, i);
+        const std::size_t k = context.get_num_blocks();
+        const block_t* m = context.get_modulus().ref_blocks();
+        std::vector<block_t> blocks(k);
+        gear::from_limbs52(blocks.data(), k, &acc[lane], num, NumLanes);
+        if (gear::compare(blocks.data(), m, k) >= 0)
+            gear::sub(blocks.data(), k, m, k);
+        results[i] = Integer::from_blocks(blocks.data(),
+                                          gear::get_num_active_blocks(blocks.data(), k));
+    }
+}
+
+// The exponentiations whose contexts use 52-bit limbs are grouped by the number of the
+// limbs for the lanes. The others are calculated by ModContext::pow().
+static std::vector<Integer> calc(std::span<const Integer> bases,
+                                 std::span<const Integer> exponents,
+                                 std::span<const ModContext* const> contexts,
+                                 const Backend backend) {
+    std::vector<Integer> results(bases.size(), constant::Zero);
+    std::vector<std::pair<std::size_t, std::size_t>> order; // (num, index)
+    for (std::size_t i = 0; i < bases.size(); i++) {
+        const ModContext& context = *get_element(contexts, i);
+        const ModContext::Limbs52* limbs =
+          (backend == Backend::Avx512Ifma) ? context.get_limbs52() : nullptr;
+        if (limbs)
+            order.emplace_back(limbs->num, i);
+        else
+            results[i] = context.pow(bases[i], get_element(exponents, i));
+    }
+    std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
+
+    std::vector<std::size_t> indices;
+    for (std::size_t k = 0; k < order.size(); k++) {
+        indices.emplace_back(order[k].second);
+        const bool is_last = (k + 1 == order.size() || order[k + 1].first != order[k].first);
+        if (indices.size() == NumLanes || is_last) {
+            calc_lanes(bases, exponents, contexts, indices, order[k].first, results);
+            indices.clear();
+        }
+    }
+    return results;
+}
+
+static void check_modulus(const Integer& modulus) {
+    if (!modulus.is_odd() || modulus == constant::One)
+        throw std::invalid_argument("A modulus must be odd and greater than one");
+}
+
+static void check_exponents(std::span<const Integer> bases, std::span<const Integer> exponents) {
+    if (exponents.size() != 1 && exponents.size() != bases.size())
+        throw std::invalid_argument("The size of exponents doesn't match bases");
+}
+
+std::vector<Integer> calc(std::span<const Integer> bases, std::span<const Integer> exponents,
+                          std::span<const Integer> moduli, const Backend backend) {
+    check_exponents(bases, exponents);
+    if (moduli.size() != 1 && moduli.size() != bases.size())
+        throw std::invalid_argument("The size of moduli doesn't match bases");
+    for (const Integer& modulus: moduli)
+        check_modulus(modulus);
+
+    // A context is shared by the consecutive moduli with the same value.
+    std::vector<std::unique_ptr<const ModContext>> owners;
+    std::vector<const ModContext*> contexts;
+    for (const Integer& modulus: moduli) {
+        if (owners.empty() || owners.back()->get_modulus() != modulus)
+            owners.emplace_back(std::make_unique<const ModContext>(modulus));
+        contexts.emplace_back(owners.back().get());
+    }
+    return calc(bases, exponents, contexts, backend);
+}
+
+std::vector<Integer> calc(std::span<const Integer> bases, std::span<const Integer> exponents,
+                          const ModContext& context, const Backend backend) {
+    check_exponents(bases, exponents);
+    check_modulus(context.get_modulus());
+    const ModContext* const contexts[] = {&context};
+    return calc(bases, exponents, contexts, backend);
+}
+
+} // namespace batch_pow_mod
+} // namespace grill
@@ -0,0 +1,275 @@
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include "constant.h"
+#include "util.h"
+#include "primality.h"
+#include "ThreadPool.h"
+#include "factorization.h"
+
+namespace grill {
+
+using uint128_t = unsigned __int128;
+using block_t = Integer::block_t;
+
+// n / d, where d divides n.
+static Integer divide(const Integer& n, const block_t d) {
+    const std::size_t num = n.get_num_blocks();
+    const block_t* blocks = n.ref_blocks();
+    block_t q[num];
+    uint128_t r = 0;
+    for (std::size_t i = num; i > 0; i--) {
+        const uint128_t x = (r << 64) | blocks[i - 1];
+        q[i - 1] = x / d;
+        r = x % d;
+    }
+    return Integer::from_blocks(q, gear::get_num_active_blocks(q, num));
+}
+
+//
+// Arithmetic for the rho sequence
+//
+// The values are not converted to Montgomery form. x -> x^2 R^-1 + c is still
+// a polynomial map modulo every factor of n because R is invertible.
+//
+class RhoArithmetic64 {
+public:
+    RhoArithmetic64(const block_t* n, const block_t* c)
+    : mont(*n),
+      c(*c) {
+    }
+
+    // x = x^2 R^-1 + c
+    void step(block_t* x) const {
+        const block_t n = this->mont.get_modulus();
+        const block_t y = this->mont.mul(*x, *x);
+        *x = (y >= n - this->c) ? y - (n - this->c) : y + this->c;
+    }
+
+    // out = a * b * R^-1
+    void mul(block_t* out, const block_t* a, const block_t* b) const {
+        *out = this->mont.mul(*a, *b);
+    }
+
+private:
+    const gear::Montgomery64 mont;
+    const block_t c;
+};
+
+class RhoArithmetic {
+public:
+    RhoArithmetic(const block_t* n, const block_t* c, const std::size_t num)
+    : n(n, n + num),
+      c(c, c + num),
+      n0inv(gear::montgomery_n0inv(n[0])) {
+    }
+
+    // x = x^2 R^-1 + c
+    void step(block_t* x) const {
+        const std::size_t num = this->n.size();
+        gear::montgomery_mul(x, x, x, this->n.data(), num, this->n0inv);
+        const bool carry = gear::add(x, num, this->c.data(), num);
+        if (carry || gear::compare(x, this->n.data(), num) >= 0)
+            gear::sub(x, num, this->n.data(), num);
+    }
+
+    // out = a * b * R^-1
+    void mul(block_t* out, const block_t* a, const block_t* b) const {
+        gear::montgomery_mul(out, a, b, this->n.data(), this->n.size(), this->n0inv);
+    }
+
+private:
+    const std::vector<block_t> n;
+    const std::vector<block_t> c;
+    const uint64_t n0inv;
+};
+
+// out = |a - b|
+static void sub_abs(block_t* out, const block_t* a, const block_t* b, const std::size_t num) {
+    const bool a_is_less = gear::compare(a, b, num) < 0;
+    gear::copy(out, a_is_less ? b : a, num);
+    gear::sub(out, num, a_is_less ? a : b, num);
+}
+
+//
+// Pollard-Brent rho
+//
+// The sequence y is compared with x, which is updated at the powers of two. The products
+// of |x - y| are accumulated, and a gcd is calculated for a batch. If the gcd is n, the
+// iterations from the last batch are repeated with a gcd for each.
+template<typename Arithmetic>
+static std::optional<Integer> run_brent(const Integer& n, const Arithmetic& arith,
+                                        std::vector<block_t> y,
+                                        const factorization::Options& options,
+                                        const std::atomic<bool>& found) {
+    const std::size_t num = y.size();
+    std::vector<block_t> x(num), ys(num), q(num, 0), diff(num);
+    q[0] = 1;
+
+    const auto calc_gcd = [&](const std::vector<block_t>& v) {
+        const std::size_t num_active = gear::get_num_active_blocks(v.data(), num);
+        return util::gcd(Integer::from_blocks(v.data(), num_active), n);
+    };
+
+    Integer g(constant::One);
+    std::size_t num_iterations = 0;
+    for (std::size_t r = 1; g == constant::One; r *= 2) {
+        x = y;
+        for (std::size_t i = 0; i < r; i++)
+            arith.step(y.data());
+        num_iterations += r;
+
+        for (std::size_t k = 0; k < r && g == constant::One; k += options.batch_size) {
+            if (found)
+                return std::nullopt;
+            if (options.max_iterations > 0 && num_iterations >= options.max_iterations)
+                return std::nullopt;
+
+            ys = y;
+            const std::size_t num_steps = std::min(options.batch_size, r - k);
+            for (std::size_t i = 0; i < num_steps; i++) {
+                arith.step(y.data());
+                sub_abs(diff.data(), x.data(), y.data(), num);
+                arith.mul(q.data(), q.data(), diff.data());
+            }
+            num_iterations += num_steps;
+            g = calc_gcd(q);
+        }
+    }
+
+    if (g == n) {
+        do {
+            arith.step(ys.data());
+            sub_abs(diff.data(), x.data(), ys.data(), num);
+            g = calc_gcd(diff);
+        } while (g == constant::One);
+    }
+    if (g == n)
+        return std::nullopt;
+    return g;
+}
+
+// Random blocks less than n
+static std::vector<block_t> get_random_blocks(const Integer& n, const std::size_t num,
+                                              std::mt19937_64& engine) {
+    std::vector<block_t> blocks(num);
+    for (std::size_t i = 0; i < num; i++)
+        blocks[i] = engine();
+    const block_t top = n.ref_blocks()[num - 1];
+    blocks[num - 1] = (top == 0) ? 0 : blocks[num - 1] % top;
+    return blocks;
+}
+
+static std::optional<Integer> run_seed(const Integer& n, std::mt19937_64& engine,
+                                       const factorization::Options& options,
+                                       const std::atomic<bool>& found) {
+    const std::size_t num = gear::get_num_active_blocks(n.ref_blocks(), n.get_num_blocks());
+    std::vector<block_t> y = get_random_blocks(n, num, engine);
+    std::vector<block_t> c = get_random_blocks(n, num, engine);
+    if (gear::is_all_zero(c.data(), num))
+        c[0] = 1;
+
+    if (num == 1)
+        return run_brent(n, RhoArithmetic64(n.ref_blocks(), c.data()), y, options, found);
+    return run_brent(n, RhoArithmetic(n.ref_blocks(), c.data(), num), y, options, found);
+}
+
+std::optional<Integer> factorization::pollard_brent(const Integer& n, const Options& options) {
+    if (!n.is_odd() || n == constant::One)
+        throw std::invalid_argument("n must be an odd number greater than one");
+    // No seed finds a factor of a prime, so the workers would never stop without limits.
+    if (primality::bpsw_test(n))
+        throw std::invalid_argument("n must be a composite number");
+    if (options.batch_size == 0)
+        throw std::invalid_argument("batch_size must be greater than 0");
+
+    std::atomic<bool> found(false);
+    std::mutex factor_mutex;
+    std::optional<Integer> factor;
+    const auto worker = [&](const block_t seed) {
+        std::mt19937_64 engine(seed);
+        for (std::size_t i = 0; options.max_seeds == 0 || i < options.max_seeds; i++) {
+            std::optional<Integer> d = run_seed(n, engine, options, found);
+            if (found)
+                return;
+            if (d) {
+                std::lock_guard<std::mutex> lock(factor_mutex);
+                factor = std::move(d);
+                found = true;
+                return;
+            }
+        }
+    };
+
+    std::random_device seed_gen;
+    std::vector<block_t> seeds(ThreadPool::resolve_num_threads(options.num_threads));
+    for (block_t& seed: seeds)
+        seed = seed_gen();
+    ThreadPool pool(seeds.size());
+    pool.run(seeds.size(), [&](const std::size_t i) {
+        worker(seeds[i]);
+    });
+    return factor;
+}
+
+//
+// Factorization
+//
+// The small prime factors are moved to factors, and the rest is returned.
+static Integer remove_small_factors(const Integer& n, std::vector<Integer>& factors) {
+    const std::vector<block_t>& primes = primality::get_small_primes();
+    const std::vector<block_t> residues = primality::get_small_prime_residues(n);
+    Integer m(n);
+    for (std::size_t k = 0; k < primes.size(); k++) {
+        if (residues[k] != 0)
+            continue;
+        const block_t p = primes[k];
+        do {
+            m = divide(m, p);
+            factors.emplace_back(Integer({p}));
+        } while (gear::remainder(m.ref_blocks(), m.get_num_blocks(), p) == 0);
+    }
+    return m;
+}
+
+// n has no factor less than SmallFactorLimit.
+static bool is_prime(const Integer& n) {
+    constexpr block_t Limit = primality::SmallFactorLimit * primality::SmallFactorLimit;
+    if (n <= Integer({Limit}))
+        return true;
+    return n.fits_in_block() ? primality::miller_rabin_test(n.ref_blocks()[0])
+                             : primality::bpsw_test(n);
+}
+
+static void split(const Integer& n, std::vector<Integer>& factors,
+                  const factorization::Options& options) {
+    if (is_prime(n)) {
+        factors.emplace_back(n);
+        return;
+    }
+    const Integer d = *factorization::pollard_brent(n, options);
+    split(d, factors, options);
+    split(n / d, factors, options);
+}
+
+std::vector<Integer> factorization::factorize(const Integer& n, const Options& options) {
+    if (n.is_zero())
+        throw std::invalid_argument("n must be positive");
+
+    std::vector<Integer> factors;
+    const Integer m = remove_small_factors(n, factors);
+    if (m != constant::One) {
+        Options unlimited = options;
+        unlimited.max_iterations = 0;
+        unlimited.max_seeds = 0;
+        split(m, factors, unlimited);
+    }
+    std::sort(factors.begin(), factors.end(), [](const Integer& a, const Integer& b) {
+        return !(a >= b);
+    });
+    return factors;
+}
+
+} // namespace grill
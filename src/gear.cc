@@ -1,9 +1,17 @@
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <utility>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 #include "gear.h"
 #include "util.h"
 
 namespace grill {
 
+using uint128_t = unsigned __int128;
+
 static constexpr uint64_t One = 1;
 
 static uint32_t upper(const uint64_t a) {
@@ -110,6 +118,28 @@ static void karatsuba_add(uint64_t* out, const std::size_t n_out,
     gear::add(&out[offset], n_out - offset, x, num_x);
 }
 
+// The schoolbook method is faster than Karatsuba method when either number has blocks
+// not more than this.
+static constexpr std::size_t KaratsubaThreshold = 32;
+
+// The blocks over n_out are dropped. They are zero when the product fits in n_out blocks.
+static void mul_schoolbook(uint64_t* out, const std::size_t n_out,
+                           const uint64_t* in0, const std::size_t num_in0,
+                           const uint64_t* in1, const std::size_t num_in1) {
+    gear::fill_zero(out, n_out);
+    for (std::size_t i = 0; i < num_in0 && i < n_out; i++) {
+        const std::size_t num_row = std::min(num_in1, n_out - i);
+        uint64_t carry = 0;
+        for (std::size_t j = 0; j < num_row; j++) {
+            const uint128_t t = static_cast<uint128_t>(in0[i]) * in1[j] + out[i + j] + carry;
+            out[i + j] = t;
+            carry = t >> 64;
+        }
+        if (i + num_row < n_out)
+            out[i + num_row] = carry;
+    }
+}
+
 void gear::karatsuba(uint64_t* out, const std::size_t n_out,
                      const uint64_t* in0, const std::size_t num_in0,
                      const uint64_t* in1, const std::size_t num_in1) {
@@ -118,9 +148,8 @@ void gear::karatsuba(uint64_t* out, const std::size_t n_out,
         return;
     }
 
-    if (num_in0 == 1 && num_in1 == 1) {
-        assert(n_out == 2);
-        mul(out, *in0, *in1);
+    if (num_in0 <= KaratsubaThreshold || num_in1 <= KaratsubaThreshold) {
+        mul_schoolbook(out, n_out, in0, num_in0, in1, num_in1);
         return;
     }
 
@@ -147,4 +176,424 @@ void gear::karatsuba(uint64_t* out, const std::size_t n_out,
     karatsuba_add(out, n_out, x1, num_x1, num_lower_half);
 }
 
+uint64_t gear::remainder(const uint64_t* blocks, const std::size_t num, const uint64_t d) {
+    uint128_t r = 0;
+    for (std::size_t i = num; i > 0; i--)
+        r = ((r << 64) | blocks[i-1]) % d;
+    return r;
+}
+
+uint64_t gear::montgomery_n0inv(const uint64_t n0) {
+    // Newton's method. x = n0 is correct in the lower 3 bits because n0 * n0 = 1 (mod 8),
+    // and the number of the correct bits doubles in every step.
+    uint64_t x = n0;
+    for (int i = 0; i < 5; i++)
+        x *= 2 - n0 * x;
+    return -x;
+}
+
+// Coarsely Integrated Operand Scanning (CIOS).
+// t has num + 2 blocks and the result is stored in t[0..num].
+static void montgomery_cios(uint64_t* t, const uint64_t* a, const uint64_t* b,
+                            const uint64_t* n, const std::size_t num, const uint64_t n0inv) {
+    gear::fill_zero(t, num + 2);
+    for (std::size_t i = 0; i < num; i++) {
+        uint64_t carry = 0;
+        for (std::size_t j = 0; j < num; j++) {
+            const uint128_t x = static_cast<uint128_t>(a[j]) * b[i] + t[j] + carry;
+            t[j] = x;
+            carry = x >> 64;
+        }
+        uint128_t x = static_cast<uint128_t>(t[num]) + carry;
+        t[num] = x;
+        t[num+1] = x >> 64;
+
+        const uint64_t u = t[0] * n0inv;
+        x = static_cast<uint128_t>(u) * n[0] + t[0];
+        carry = x >> 64;
+        for (std::size_t j = 1; j < num; j++) {
+            x = static_cast<uint128_t>(u) * n[j] + t[j] + carry;
+            t[j-1] = x;
+            carry = x >> 64;
+        }
+        x = static_cast<uint128_t>(t[num]) + carry;
+        t[num-1] = x;
+        t[num] = t[num+1] + static_cast<uint64_t>(x >> 64);
+    }
+}
+
+void gear::montgomery_mul(uint64_t* out, const uint64_t* a, const uint64_t* b,
+                          const uint64_t* n, const std::size_t num, const uint64_t n0inv) {
+    uint64_t t[num + 2];
+    montgomery_cios(t, a, b, n, num, n0inv);
+    if (t[num] != 0 || gear::compare(t, n, num) >= 0)
+        gear::sub(t, num, n, num);
+    gear::copy(out, t, num);
+}
+
+void gear::montgomery_mul_lazy(uint64_t* out, const uint64_t* a, const uint64_t* b,
+                               const uint64_t* n, const std::size_t num, const uint64_t n0inv) {
+    uint64_t t[num + 2];
+    montgomery_cios(t, a, b, n, num, n0inv);
+    assert(t[num] == 0);
+    gear::copy(out, t, num);
+}
+
+// t = a^2, where t has 2 * num + 1 blocks. Each cross product a[i] a[j] (i < j) is
+// calculated once and doubled, so it costs about half the multiplications of a * a.
+static void square_blocks(uint64_t* t, const uint64_t* a, const std::size_t num) {
+    gear::fill_zero(t, 2 * num + 1);
+    for (std::size_t i = 0; i + 1 < num; i++) {
+        uint64_t carry = 0;
+        for (std::size_t j = i + 1; j < num; j++) {
+            const uint128_t x = static_cast<uint128_t>(a[i]) * a[j] + t[i+j] + carry;
+            t[i+j] = x;
+            carry = x >> 64;
+        }
+        t[i+num] = carry;
+    }
+    for (std::size_t i = 2 * num - 1; i > 0; i--)
+        t[i] = (t[i] << 1) | (t[i-1] >> 63);
+    t[0] <<= 1;
+
+    uint64_t carry = 0;
+    for (std::size_t i = 0; i < num; i++) {
+        const uint128_t sq = static_cast<uint128_t>(a[i]) * a[i];
+        uint128_t x = static_cast<uint128_t>(t[2*i]) + static_cast<uint64_t>(sq) + carry;
+        t[2*i] = x;
+        x = static_cast<uint128_t>(t[2*i+1]) + static_cast<uint64_t>(sq >> 64) + (x >> 64);
+        t[2*i+1] = x;
+        carry = x >> 64;
+    }
+}
+
+// Montgomery reduction of t with 2 * num + 1 blocks. The result is stored in t[num..2*num].
+static void montgomery_redc(uint64_t* t, const uint64_t* n, const std::size_t num,
+                            const uint64_t n0inv) {
+    uint64_t top = 0;
+    for (std::size_t i = 0; i < num; i++) {
+        const uint64_t u = t[i] * n0inv;
+        uint64_t carry = 0;
+        for (std::size_t j = 0; j < num; j++) {
+            const uint128_t x = static_cast<uint128_t>(u) * n[j] + t[i+j] + carry;
+            t[i+j] = x;
+            carry = x >> 64;
+        }
+        const uint128_t x = static_cast<uint128_t>(t[i+num]) + carry + top;
+        t[i+num] = x;
+        top = x >> 64;
+    }
+    t[2*num] = top;
+}
+
+void gear::montgomery_sqr(uint64_t* out, const uint64_t* a,
+                          const uint64_t* n, const std::size_t num, const uint64_t n0inv) {
+    uint64_t t[2 * num + 1];
+    square_blocks(t, a, num);
+    montgomery_redc(t, n, num, n0inv);
+    if (t[2*num] != 0 || gear::compare(&t[num], n, num) >= 0)
+        gear::sub(&t[num], num, n, num);
+    gear::copy(out, &t[num], num);
+}
+
+void gear::montgomery_sqr_lazy(uint64_t* out, const uint64_t* a,
+                               const uint64_t* n, const std::size_t num, const uint64_t n0inv) {
+    uint64_t t[2 * num + 1];
+    square_blocks(t, a, num);
+    montgomery_redc(t, n, num, n0inv);
+    assert(t[2*num] == 0);
+    gear::copy(out, &t[num], num);
+}
+
+//
+// Radix 2^52
+//
+static constexpr uint64_t Limb52Mask = (One << gear::Limb52Bits) - 1;
+
+bool gear::is_ifma_supported() {
+#if defined(__x86_64__)
+    static const bool supported =
+      __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512ifma");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+void gear::to_limbs52(uint64_t* limbs, const std::size_t num_limbs,
+                      const uint64_t* blocks, const std::size_t num_blocks,
+                      const std::size_t stride) {
+    for (std::size_t j = 0; j < num_limbs; j++) {
+        const std::size_t pos = j * Limb52Bits;
+        const std::size_t index = pos / 64;
+        const int shift = pos % 64;
+        uint64_t v = (index < num_blocks) ? blocks[index] >> shift : 0;
+        if (shift > 64 - Limb52Bits && index + 1 < num_blocks)
+            v |= blocks[index + 1] << (64 - shift);
+        limbs[j * stride] = v & Limb52Mask;
+    }
+}
+
+void gear::from_limbs52(uint64_t* blocks, const std::size_t num_blocks,
+                        const uint64_t* limbs, const std::size_t num_limbs,
+                        const std::size_t stride) {
+    gear::fill_zero(blocks, num_blocks);
+    for (std::size_t j = 0; j < num_limbs; j++) {
+        const uint64_t v = limbs[j * stride];
+        const std::size_t pos = j * Limb52Bits;
+        const std::size_t index = pos / 64;
+        const int shift = pos % 64;
+        if (index < num_blocks)
+            blocks[index] |= v << shift;
+        if (shift > 64 - Limb52Bits && index + 1 < num_blocks)
+            blocks[index + 1] |= v >> (64 - shift);
+    }
+}
+
+#if defined(__x86_64__)
+// The masked forms are used because the unmasked ones trigger -Wmaybe-uninitialized of GCC.
+static constexpr __mmask8 AllLanes = 0xff;
+
+// The accumulator x has the limbs of the partial result in V registers. For each limb
+// of b, a * b_i and u * n are added, where u makes the lowest limb zero, and the
+// accumulator is shifted down by a limb. The lower 52 bits of the products are added
+// before the shift and the upper bits after it. An element gets at most 4 * num products
+// of 52 bits without carries, so it doesn't overflow for MaxNumLimbs52.
+template<std::size_t V>
+__attribute__((target("avx512f,avx512ifma")))
+static void montgomery_mul52_kernel(uint64_t* out, const uint64_t* a, const uint64_t* b,
+                                    const uint64_t* n, const std::size_t num,
+                                    const uint64_t n0inv) {
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i x[V], av[V], nv[V];
+    for (std::size_t v = 0; v < V; v++) {
+        x[v] = zero;
+        av[v] = _mm512_loadu_si512(&a[v * 8]);
+        nv[v] = _mm512_loadu_si512(&n[v * 8]);
+    }
+
+    for (std::size_t i = 0; i < num; i++) {
+        const __m512i bi = _mm512_set1_epi64(b[i]);
+        for (std::size_t v = 0; v < V; v++)
+            x[v] = _mm512_madd52lo_epu64(x[v], av[v], bi);
+        const uint64_t x0 = x[0][0];
+        const uint64_t u = (x0 * n0inv) & Limb52Mask;
+        const uint64_t carry = (x0 + ((u * n[0]) & Limb52Mask)) >> gear::Limb52Bits;
+        const __m512i uv = _mm512_set1_epi64(u);
+        for (std::size_t v = 0; v < V; v++)
+            x[v] = _mm512_madd52lo_epu64(x[v], nv[v], uv);
+
+        for (std::size_t v = 0; v + 1 < V; v++)
+            x[v] = _mm512_maskz_alignr_epi64(AllLanes, x[v + 1], x[v], 1);
+        x[V - 1] = _mm512_maskz_alignr_epi64(AllLanes, zero, x[V - 1], 1);
+        x[0] = _mm512_add_epi64(x[0], _mm512_maskz_set1_epi64(1, carry));
+
+        for (std::size_t v = 0; v < V; v++) {
+            x[v] = _mm512_madd52hi_epu64(x[v], av[v], bi);
+            x[v] = _mm512_madd52hi_epu64(x[v], nv[v], uv);
+        }
+    }
+
+    uint64_t t[V * 8];
+    for (std::size_t v = 0; v < V; v++)
+        _mm512_storeu_si512(&t[v * 8], x[v]);
+    uint64_t carry = 0;
+    for (std::size_t j = 0; j < V * 8; j++) {
+        const uint64_t y = t[j] + carry;
+        out[j] = y & Limb52Mask;
+        carry = y >> gear::Limb52Bits;
+    }
+}
+
+using MontgomeryMul52Kernel = void (*)(uint64_t*, const uint64_t*, const uint64_t*,
+                                       const uint64_t*, const std::size_t, const uint64_t);
+
+template<std::size_t... V>
+static constexpr std::array<MontgomeryMul52Kernel, sizeof...(V)>
+create_montgomery_mul52_kernels(std::index_sequence<V...>) {
+    return {&montgomery_mul52_kernel<V + 1>...};
+}
+
+// The kernel for V registers is at V - 1.
+static constexpr auto montgomery_mul52_kernels =
+  create_montgomery_mul52_kernels(std::make_index_sequence<gear::MaxNumLimbs52 / 8>());
+
+void gear::montgomery_mul52(uint64_t* out, const uint64_t* a, const uint64_t* b,
+                            const uint64_t* n, const std::size_t num, const uint64_t n0inv) {
+    assert(num > 0 && num <= MaxNumLimbs52);
+    montgomery_mul52_kernels[get_limb52_buffer_size(num) / 8 - 1](out, a, b, n, num, n0inv);
+}
+#else
+void gear::montgomery_mul52(uint64_t*, const uint64_t*, const uint64_t*,
+                            const uint64_t*, const std::size_t, const uint64_t) {
+    assert(false);
+}
+#endif
+
+//
+// Fixed window method of exponentiation
+//
+int gear::choose_window_bits(const int exponent_bits) {
+    if (exponent_bits > 671)
+        return 6;
+    if (exponent_bits > 239)
+        return 5;
+    if (exponent_bits > 79)
+        return 4;
+    if (exponent_bits > 23)
+        return 3;
+    return 1;
+}
+
+unsigned int gear::get_window(const uint64_t* e, const std::size_t num, const int pos,
+                              const int width) {
+    unsigned int v = 0;
+    for (int i = width - 1; i >= 0; i--) {
+        const std::size_t b = pos + i;
+        const std::size_t index = b / 64;
+        v = (v << 1) | ((index < num) ? (e[index] >> (b % 64)) & 1 : 0);
+    }
+    return v;
+}
+
+// -1 for a zero exponent
+static int get_msb(const uint64_t* e, const std::size_t num_active) {
+    return (num_active == 0 || e[num_active-1] == 0) ? -1 : 63 - __builtin_clzll(e[num_active-1]);
+}
+
+uint64_t gear::mul_mod(const uint64_t a, const uint64_t b, const uint64_t m) {
+    return static_cast<uint128_t>(a) * b % m;
+}
+
+uint64_t gear::pow_mod(const uint64_t base, const uint64_t* e, const std::size_t num,
+                       const uint64_t m) {
+    if (m & 1) {
+        const Montgomery64 mont(m);
+        return mont.from_montgomery(mont.pow(mont.to_montgomery(base), e, num));
+    }
+
+    const uint64_t b = base % m;
+    uint64_t r = 1 % m;
+    std::size_t i = gear::get_num_active_blocks(e, num);
+    for (int bit = get_msb(e, i); i > 0; i--, bit = 63) {
+        for (; bit >= 0; bit--) {
+            r = mul_mod(r, r, m);
+            if ((e[i-1] >> bit) & 1)
+                r = mul_mod(r, b, m);
+        }
+    }
+    return r;
+}
+
+gear::Montgomery64::Montgomery64(const uint64_t n)
+: n(n),
+  ninv(-montgomery_n0inv(n)),
+  r1((static_cast<uint128_t>(1) << 64) % n) {
+    assert(n & 1);
+}
+
+uint64_t gear::Montgomery64::to_montgomery(const uint64_t a) const {
+    return (static_cast<uint128_t>(a % this->n) << 64) % this->n;
+}
+
+uint64_t gear::Montgomery64::pow(const uint64_t base, const uint64_t* e,
+                                 const std::size_t num) const {
+    uint64_t r = this->r1;
+    std::size_t i = gear::get_num_active_blocks(e, num);
+    for (int bit = get_msb(e, i); i > 0; i--, bit = 63) {
+        for (; bit >= 0; bit--) {
+            r = mul(r, r);
+            if ((e[i-1] >> bit) & 1)
+                r = mul(r, base);
+        }
+    }
+    return r;
+}
+
+// The products are less than 2^63, so every shift is at least 1.
+static constexpr uint64_t MaxProduct = (One << 63) - 1;
+
+gear::SmallDivisors::SmallDivisors(const std::vector<uint64_t>& divisors)
+: num_divisors(divisors.size()),
+  divisors(divisors) {
+    const auto add_product = [this](const uint64_t product, const std::size_t num) {
+        const int shift = __builtin_clzll(product);
+        const uint64_t normalized = product << shift;
+        const uint64_t reciprocal = ~static_cast<uint128_t>(0) / normalized;
+        this->products.push_back({normalized, reciprocal, shift, num});
+    };
+
+    uint64_t product = 1;
+    std::size_t num = 0;
+    for (const uint64_t d: divisors) {
+        assert(d >= 2 && d < Limit);
+        this->divisor_reciprocals.emplace_back(static_cast<uint64_t>(~uint64_t(0) / d));
+        if (product > MaxProduct / d) {
+            add_product(product, num);
+            product = 1;
+            num = 0;
+        }
+        product *= d;
+        num++;
+    }
+    if (num > 0)
+        add_product(product, num);
+    while (this->products.size() % Lanes != 0)
+        add_product(1, 0);
+}
+
+// Möller and Granlund, "Improved division by invariant integers", Algorithm 4.
+// It returns (u1 * 2^64 + u0) mod d, where d is normalized and u1 < d.
+static uint64_t reduce_2by1(const uint64_t u1, const uint64_t u0,
+                            const uint64_t d, const uint64_t v) {
+    const uint128_t q = static_cast<uint128_t>(v) * u1 +
+                        ((static_cast<uint128_t>(u1 + 1) << 64) | u0);
+    const uint64_t q1 = q >> 64;
+    const uint64_t q0 = q;
+    uint64_t r = u0 - q1 * d;
+    r += d & -static_cast<uint64_t>(r > q0); // Unpredictable, so it is done without a branch
+    if (__builtin_expect(r >= d, 0))
+        r -= d;
+    return r;
+}
+
+// floor(x * m / 2^64) is floor(x / d) or less by one, because m > 2^64 / d - 1.
+static uint64_t reduce_1by1(const uint64_t x, const uint64_t d, const uint64_t m) {
+    const uint64_t q = (static_cast<uint128_t>(x) * m) >> 64;
+    const uint64_t r = x - q * d;
+    return (r >= d) ? r - d : r;
+}
+
+void gear::SmallDivisors::remainders(uint64_t* out, const uint64_t* blocks,
+                                     const std::size_t num) const {
+    std::size_t divisor_idx = 0;
+    for (std::size_t k = 0; k < this->products.size(); k += Lanes) {
+        const Product* p = &this->products[k];
+
+        // The number shifted by each `shift` is reduced by the normalized product,
+        // so the remainder is also shifted. The top bits out of the blocks are the
+        // initial remainder, which is less than 2^shift.
+        uint64_t r[Lanes];
+        for (std::size_t j = 0; j < Lanes; j++)
+            r[j] = (num == 0) ? 0 : blocks[num-1] >> (64 - p[j].shift);
+        for (std::size_t i = num; i > 0; i--) {
+            const uint64_t lower = (i >= 2) ? blocks[i-2] : 0;
+            #pragma GCC unroll 4
+            for (std::size_t j = 0; j < Lanes; j++) {
+                const int shift = p[j].shift;
+                const uint64_t u0 = (blocks[i-1] << shift) | (lower >> (64 - shift));
+                r[j] = reduce_2by1(r[j], u0, p[j].normalized, p[j].reciprocal);
+            }
+        }
+
+        for (std::size_t j = 0; j < Lanes; j++) {
+            const uint64_t product_r = r[j] >> p[j].shift;
+            for (std::size_t n = 0; n < p[j].num_divisors; n++, divisor_idx++) {
+                out[divisor_idx] = reduce_1by1(product_r, this->divisors[divisor_idx],
+                                               this->divisor_reciprocals[divisor_idx]);
+            }
+        }
+    }
+}
+
 } // namespace grill
@@ -1,54 +1,138 @@
 #include <ostream>
 #include <vector>
+#include <memory>
+#include <optional>
+#include <cstdlib>
+#include <cmath>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
 #include "primality.h"
 #include "constant.h"
+#include "ModInteger.h"
+#include "PrimeSieve.h"
+#include "ThreadPool.h"
 
 namespace grill {
 
-static bool is_zero(const Integer::block_t n) {
-    return n == 0;
+// The primes are streamed from PrimeSieve until p^2 > n.
+bool primality::trivial_division(const Integer::block_t n) {
+    if (n < 2)
+        return false;
+    const Integer::block_t sqrt_n = std::sqrt(static_cast<long double>(n));
+    for (const Integer::block_t p: PrimeSieve(2, sqrt_n + 2)) {
+        if (p > n / p)
+            break;
+        if (n % p == 0)
+            return false;
+    }
+    return true;
 }
 
-static bool is_zero(const Integer& n) {
-    return n.is_zero();
+static std::vector<Integer::block_t> get_primes_less_than(const Integer::block_t limit) {
+    std::vector<Integer::block_t> primes;
+    for (const auto p: PrimeSieve::get_small_primes(limit)) {
+        if (p >= limit)
+            break;
+        primes.emplace_back(p);
+    }
+    return primes;
 }
 
-template<typename T>
-bool templated_trivial_division(const T& n, const T& two, const T& three) {
-    if (n == two)
-        return true;
-    if (is_zero(n % two))
+// The primes less than this value are tried at once by SmallDivisors.
+static constexpr Integer::block_t BatchTrialDivisorLimit = 1 << 16;
+
+static const gear::SmallDivisors& get_trial_divisors() {
+    static const gear::SmallDivisors divisors(get_primes_less_than(BatchTrialDivisorLimit));
+    return divisors;
+}
+
+bool primality::trivial_division(const Integer& n) {
+    if (n.fits_in_block())
+        return trivial_division(n.ref_blocks()[0]);
+
+    const Integer::block_t* blocks = n.ref_blocks();
+    const std::size_t num_blocks = gear::get_num_active_blocks(blocks, n.get_num_blocks());
+
+    // n is over 2^64, so all the primes less than BatchTrialDivisorLimit are tried at once.
+    const auto& divisors = get_trial_divisors();
+    std::vector<Integer::block_t> residues(divisors.size());
+    divisors.remainders(residues.data(), blocks, num_blocks);
+    if (std::find(residues.begin(), residues.end(), 0) != residues.end())
         return false;
 
-    std::vector<T> prime_numbers = {};
-    auto is_prime = [&](const T& i) {
-        for (const auto& prime: prime_numbers) {
-            if (is_zero(i % prime))
-                return false;
-        }
-        return true;
-    };
+    // p^2 is less than 2^64, so it never exceeds n. The sieving primes of this range are
+    // in the initial small-prime table.
+    for (const Integer::block_t p: PrimeSieve(BatchTrialDivisorLimit, TrialDivisionLimit)) {
+        if (gear::remainder(blocks, num_blocks, p) == 0)
+            return false;
+    }
+    // The divisors up to sqrt(n) are too many for n over 2^64.
+    return bpsw_test(n);
+}
 
-    for (T i = three; (i * i) <= n; i += two) {
-        if (is_prime(i)) {
-            prime_numbers.emplace_back(i);
-            if (is_zero(n % i))
-                return false;
+//
+// Small factor filter
+//
+struct SmallPrimeProducts {
+    const std::vector<Integer::block_t> primes;
+    const gear::SmallDivisors divisors;
+    std::vector<Integer::block_t> products; // Each product of consecutive primes fits in a block
+
+    SmallPrimeProducts()
+    : primes(get_primes_less_than(primality::SmallFactorLimit)),
+      divisors(this->primes) {
+        Integer::block_t product = 1;
+        for (const auto p: this->primes) {
+            if (product > std::numeric_limits<Integer::block_t>::max() / p) {
+                this->products.emplace_back(product);
+                product = 1;
+            }
+            product *= p;
         }
+        this->products.emplace_back(product);
     }
-    return true;
+
+    static const SmallPrimeProducts& get_instance() {
+        static const SmallPrimeProducts instance;
+        return instance;
+    }
+};
+
+bool primality::has_small_factor(const Integer& n) {
+    const auto& small_primes = SmallPrimeProducts::get_instance();
+    const Integer::block_t* blocks = n.ref_blocks();
+    const std::size_t num_blocks = n.get_num_blocks();
+    for (const auto product: small_primes.products) {
+        const Integer::block_t g = std::gcd(gear::remainder(blocks, num_blocks, product), product);
+        if (g == 1)
+            continue;
+
+        // g is a divisor of n. n itself is a small prime when g is n and in the table.
+        if (Integer({g}) != n)
+            return true;
+        return !std::binary_search(small_primes.primes.begin(), small_primes.primes.end(), g);
+    }
+    return false;
 }
 
-bool primality::trivial_division(const Integer::block_t n) {
-    return templated_trivial_division<Integer::block_t>(n, 2, 3);
+const std::vector<Integer::block_t>& primality::get_small_primes() {
+    return SmallPrimeProducts::get_instance().primes;
 }
 
-bool primality::trivial_division(const Integer& n) {
-    return templated_trivial_division<Integer>(n, constant::Two, constant::Three);
+std::vector<Integer::block_t> primality::get_small_prime_residues(const Integer& n) {
+    const auto& small_primes = SmallPrimeProducts::get_instance();
+    std::vector<Integer::block_t> residues(small_primes.primes.size());
+    small_primes.divisors.remainders(residues.data(), n.ref_blocks(), n.get_num_blocks());
+    return residues;
 }
 
-static bool pass_fermat_little_theorem(const Integer& n, const Integer& a) {
-    return (a.pow_mod(n - constant::One, n) == constant::One);
+static bool pass_fermat_little_theorem(const Integer& a, const Integer& minus_one,
+                                       const std::shared_ptr<const ModContext>& context,
+                                       const ModInteger& one) {
+    return ModInteger::pow(a, minus_one, context) == one;
 }
 
 static const Integer fermat_test_data[] = {
@@ -64,11 +148,31 @@ static const Integer fermat_test_data[] = {
     Integer({29}),
 };
 
-bool primality::fermat_test(const Integer& n) {
+// The context of a candidate isn't taken from ModContextCache. It is shared only among
+// the bases and would evict the contexts of long-lived moduli.
+static bool fermat_test_for_block(const Integer::block_t n) {
+    for (const auto& a: fermat_test_data) {
+        const Integer::block_t a0 = a.ref_blocks()[0];
+        if (a0 >= n)
+            continue;
+        if (gear::pow_mod(a0, n - 1, n) != 1)
+            return false;
+    }
+    return true;
+}
+
+bool primality::fermat_test(const Integer& n, const bool small_factor_filter) {
+    if (small_factor_filter && has_small_factor(n))
+        return false;
+    if (n.fits_in_block())
+        return fermat_test_for_block(n.ref_blocks()[0]);
+    const Integer minus_one = n - constant::One;
+    const auto context = std::make_shared<const ModContext>(n);
+    const ModInteger one(constant::One, context);
     for (const auto& a: fermat_test_data) {
         if (a >= n)
             continue;
-        if (!pass_fermat_little_theorem(n, a))
+        if (!pass_fermat_little_theorem(a, minus_one, context, one))
             return false;
     }
     return true;
@@ -103,36 +207,486 @@ enum class NumberType {
     Composite,
 };
 
-static Integer miller_rabin_formula(const Integer& a, const Integer& exp, const Integer& n) {
-    return a.pow_mod(exp, n);
-}
+struct MillerRabinContext {
+    const std::shared_ptr<const ModContext> context;
+    const ModInteger one;
+    const ModInteger minus_one; // n-1 is congruent to -1 (mod n)
+
+    MillerRabinContext(const Integer& n, const Integer& n_minus_one)
+    : context(std::make_shared<const ModContext>(n)),
+      one(constant::One, this->context),
+      minus_one(n_minus_one, this->context) {
+    }
+};
 
-static NumberType do_miller_rabin_test(
-        const Integer& a, const Integer& n, const Integer& minus_one,
-        const MillerRabinFactors& factors) {
-    Integer exp(factors.d);
-    const Integer v0 = miller_rabin_formula(a, exp, n);
-    if (v0 == constant::One || v0 == minus_one)
+// Calculates a^d once, and then a^(2^r * d) by squaring it for r = 1 .. s-1.
+static NumberType do_miller_rabin_test(const Integer& a, const MillerRabinFactors& factors,
+                                       const MillerRabinContext& mr_ctx) {
+    ModInteger x = ModInteger::pow(a, factors.d, mr_ctx.context);
+    if (x == mr_ctx.one || x == mr_ctx.minus_one)
         return NumberType::ProbablePrime;
 
     for (std::size_t r = 1; r < factors.s; r++) {
-        exp <<= 1;
-        if (miller_rabin_formula(a, exp, n) == minus_one)
+        x = x.square();
+        if (x == mr_ctx.minus_one)
             return NumberType::ProbablePrime;
+        if (x == mr_ctx.one) // x is a non-trivial square root of 1
+            return NumberType::Composite;
     }
     return NumberType::Composite;
 }
 
-bool primality::miller_rabin_test(const Integer& n) {
-    const Integer minus_one = n - constant::One; // n-1 is congruent to -1 (mod n)
+// These bases by Jim Sinclair make the test deterministic for n < 2^64.
+static const Integer::block_t miller_rabin_test_bases_for_block[] = {
+    2, 325, 9375, 28178, 450775, 9780504, 1795265022,
+};
+
+bool primality::miller_rabin_test(const Integer::block_t n) {
+    if (n < 2)
+        return false;
+    if (n % 2 == 0)
+        return n == 2;
+
+    // n - 1 = (2^s) * d
+    const int s = __builtin_ctzll(n - 1);
+    const Integer::block_t d = (n - 1) >> s;
+    const gear::Montgomery64 mont(n);
+    const Integer::block_t one = mont.one();
+    const Integer::block_t minus_one = n - one;
+    for (const auto base: miller_rabin_test_bases_for_block) {
+        const Integer::block_t a = base % n;
+        if (a == 0)
+            continue;
+        Integer::block_t x = mont.pow(mont.to_montgomery(a), &d, 1);
+        if (x == one || x == minus_one)
+            continue;
+
+        int r = 1;
+        for (; r < s; r++) {
+            x = mont.mul(x, x);
+            if (x == minus_one || x == one)
+                break;
+        }
+        if (r == s || x == one)
+            return false;
+    }
+    return true;
+}
+
+bool primality::miller_rabin_test(const Integer& n, const bool small_factor_filter) {
+    if (small_factor_filter && has_small_factor(n))
+        return false;
+    if (n.fits_in_block())
+        return miller_rabin_test(n.ref_blocks()[0]);
+    const Integer minus_one = n - constant::One;
     const MillerRabinFactors factors(minus_one);
+    const MillerRabinContext mr_ctx(n, minus_one);
     for (const auto& a: miller_rabin_test_bases) {
         if (a >= n)
             break;
-        if (do_miller_rabin_test(a, n, minus_one, factors) == NumberType::Composite)
+        if (do_miller_rabin_test(a, factors, mr_ctx) == NumberType::Composite)
             return false;
     }
     return true;
 }
 
+//
+// Baillie-PSW primality test
+//
+// (a/n) for an odd n
+static int jacobi_symbol(uint64_t a, uint64_t n) {
+    int t = 1;
+    a %= n;
+    while (a != 0) {
+        while (a % 2 == 0) {
+            a /= 2;
+            const uint64_t r = n % 8;
+            if (r == 3 || r == 5)
+                t = -t;
+        }
+        std::swap(a, n);
+        if (a % 4 == 3 && n % 4 == 3)
+            t = -t;
+        a %= n;
+    }
+    return (n == 1) ? t : 0;
+}
+
+int primality::jacobi_symbol(const std::int64_t a, const Integer& n) {
+    const Integer::block_t n0 = n.ref_blocks()[0];
+    int t = 1;
+    if (a < 0 && n0 % 4 == 3) // (-1/n)
+        t = -t;
+
+    uint64_t b = std::abs(a);
+    if (b == 0)
+        return (n == constant::One) ? 1 : 0;
+    while (b % 2 == 0) {
+        b /= 2;
+        if (n0 % 8 == 3 || n0 % 8 == 5)
+            t = -t;
+    }
+
+    // The law of quadratic reciprocity: (b/n) = (n/b) (-1)^((b-1)(n-1)/4)
+    if (b % 4 == 3 && n0 % 4 == 3)
+        t = -t;
+    return t * grill::jacobi_symbol(gear::remainder(n.ref_blocks(), n.get_num_blocks(), b), b);
+}
+
+static bool is_perfect_square(const Integer& n) {
+    // Newton's method approaches floor(sqrt(n)) from above.
+    Integer x = constant::Zero;
+    x.set_bit_value((n.most_significant_active_bit() + 1) / 2, true);
+    while (true) {
+        Integer y = x + n / x;
+        y >>= 1;
+        if (y >= x)
+            break;
+        x = std::move(y);
+    }
+    return x * x == n;
+}
+
+// Selfridge's method A: D is the first one such that (D/n) = -1 in 5, -7, 9, -11, ...
+// No D is returned when n turns out to be composite.
+static std::optional<std::int64_t> select_lucas_d(const Integer& n) {
+    // (D/n) is never -1 for a perfect square. Other numbers find D within a few trials.
+    constexpr int SquareCheckTrial = 8;
+    std::int64_t d = 5;
+    for (int trial = 0; ; trial++) {
+        const int j = primality::jacobi_symbol(d, n);
+        if (j == -1)
+            return d;
+        if (j == 0 && Integer({static_cast<Integer::block_t>(std::abs(d))}) != n)
+            return std::nullopt;
+        if (trial == SquareCheckTrial && is_perfect_square(n))
+            return std::nullopt;
+        d = (d > 0) ? -(d + 2) : -(d - 2);
+    }
+}
+
+static ModInteger to_ModInteger(const std::int64_t v,
+                                const std::shared_ptr<const ModContext>& context) {
+    const ModInteger abs_v(Integer({static_cast<Integer::block_t>(std::abs(v))}), context);
+    return (v >= 0) ? abs_v : ModInteger(constant::Zero, context) - abs_v;
+}
+
+// Strong Lucas probable prime test with P = 1 and Q = (1 - D) / 4.
+// n + 1 = (2^s) * k, where k is odd.
+static NumberType strong_lucas_test(const Integer& n, const std::int64_t d,
+                                    const std::shared_ptr<const ModContext>& context) {
+    const ModInteger zero(constant::Zero, context);
+    const ModInteger mod_d = to_ModInteger(d, context);
+    const ModInteger mod_q = to_ModInteger((1 - d) / 4, context);
+    const MillerRabinFactors factors(n + constant::One);
+    const Integer& k = factors.d;
+
+    // U_1 = 1, V_1 = P, Q^1
+    ModInteger u(constant::One, context);
+    ModInteger v(constant::One, context);
+    ModInteger qk = mod_q;
+    for (int b = k.most_significant_active_bit() - 2; b >= 0; b--) {
+        // U_2j = U_j * V_j, V_2j = V_j^2 - 2Q^j
+        u *= v;
+        v = v.square() - qk - qk;
+        qk = qk.square();
+        if (k.get_bit_value(b)) {
+            // U_(j+1) = (P * U_j + V_j) / 2, V_(j+1) = (D * U_j + P * V_j) / 2
+            ModInteger next_u = (u + v).halve();
+            v = (mod_d * u + v).halve();
+            u = std::move(next_u);
+            qk *= mod_q;
+        }
+    }
+    if (u == zero || v == zero)
+        return NumberType::ProbablePrime;
+
+    for (std::size_t r = 1; r < factors.s; r++) {
+        v = v.square() - qk - qk;
+        qk = qk.square();
+        if (v == zero)
+            return NumberType::ProbablePrime;
+    }
+    return NumberType::Composite;
+}
+
+bool primality::bpsw_test(const Integer& n) {
+    if (n <= constant::Three)
+        return n >= constant::Two;
+    if (n.is_even())
+        return false;
+
+    const Integer minus_one = n - constant::One;
+    const MillerRabinFactors factors(minus_one);
+    const MillerRabinContext mr_ctx(n, minus_one);
+    if (do_miller_rabin_test(constant::Two, factors, mr_ctx) == NumberType::Composite)
+        return false;
+
+    const auto d = select_lucas_d(n);
+    if (!d)
+        return false;
+    return strong_lucas_test(n, *d, mr_ctx.context) == NumberType::ProbablePrime;
+}
+
+//
+// Shift-add reduction
+//
+// N = k 2^m + c, where c is 1 or -1. Since k 2^m = -c (mod N), a number
+// x = (k Q + R) 2^m + L with R < k and L < 2^m is congruent to R 2^m + L - c Q.
+// The reduction costs shifts, a division by a block and a few additions instead of
+// a long division. The residues have one more block than N for the carries.
+static std::size_t get_bit_length(const Integer::block_t x) {
+    return (x == 0) ? 0 : Integer::BlockBits - __builtin_clzll(x);
+}
+
+class ShiftAddModulus {
+public:
+    ShiftAddModulus(const Integer::block_t k, const std::size_t m, const int c)
+    : k(k),
+      m(m),
+      c(c),
+      num((get_bit_length(k) + m + Integer::BlockBits - 1) / Integer::BlockBits),
+      n(this->num + 1, 0),
+      product(2 * this->num),
+      high(2 * this->num) {
+        const std::size_t mq = m / Integer::BlockBits;
+        const std::size_t mr = m % Integer::BlockBits;
+        this->n[mq] = k << mr;
+        if (mr != 0)
+            this->n[mq + 1] = k >> (Integer::BlockBits - mr);
+        const Integer::block_t one = 1;
+        if (c > 0)
+            gear::add(this->n.data(), this->n.size(), &one, 1);
+        else
+            gear::sub(this->n.data(), this->n.size(), &one, 1);
+    }
+
+    // The number of the blocks of a residue
+    std::size_t get_num_blocks() const {
+        return this->n.size();
+    }
+
+    // x = x^2 mod N
+    void square(Integer::block_t* x) {
+        gear::karatsuba(this->product.data(), 2 * this->num, x, this->num, x, this->num);
+        this->reduce(x, this->product.data(), 2 * this->num);
+    }
+
+    // x = x a mod N
+    void mul(Integer::block_t* x, const Integer::block_t a) {
+        gear::karatsuba(this->product.data(), this->num + 1, x, this->num, &a, 1);
+        this->reduce(x, this->product.data(), this->num + 1);
+    }
+
+    // x = x - a mod N, where a < N
+    void sub(Integer::block_t* x, const Integer::block_t a) const {
+        if (gear::sub(x, this->n.size(), &a, 1))
+            gear::add(x, this->n.size(), this->n.data(), this->n.size());
+    }
+
+    bool is_minus_one(const Integer::block_t* x) const {
+        return x[0] == this->n[0] - 1 &&
+               gear::compare(x + 1, this->n.data() + 1, this->n.size() - 1) == 0;
+    }
+
+private:
+    const Integer::block_t k;
+    const std::size_t m;
+    const int c;
+    const std::size_t num;
+    std::vector<Integer::block_t> n;
+    std::vector<Integer::block_t> product;
+    std::vector<Integer::block_t> high;
+
+    // out = t mod N, where t < N^2
+    void reduce(Integer::block_t* out, const Integer::block_t* t, const std::size_t num_t) {
+        const std::size_t w = this->n.size();
+        const std::size_t mq = this->m / Integer::BlockBits;
+        const std::size_t mr = this->m % Integer::BlockBits;
+
+        // out = L
+        gear::fill_zero(out, w);
+        gear::copy(out, t, std::min(mq + (mr != 0), num_t));
+        if (mr != 0 && mq < num_t)
+            out[mq] &= (Integer::block_t(1) << mr) - 1;
+
+        // high = t >> m
+        Integer::block_t* h = this->high.data();
+        const std::size_t num_h = (num_t > mq) ? num_t - mq : 0;
+        gear::fill_zero(h, this->high.size());
+        for (std::size_t i = 0; i < num_h; i++) {
+            h[i] = t[i + mq] >> mr;
+            if (mr != 0 && i + mq + 1 < num_t)
+                h[i] |= t[i + mq + 1] << (Integer::BlockBits - mr);
+        }
+
+        // high = Q, out = R 2^m + L
+        Integer::block_t r = 0;
+        if (this->k > 1) {
+            for (std::size_t i = num_h; i > 0; i--) {
+                const unsigned __int128 x = (static_cast<unsigned __int128>(r) << 64) | h[i - 1];
+                h[i - 1] = x / this->k;
+                r = x % this->k;
+            }
+        }
+        out[mq] |= r << mr;
+        if (mr != 0)
+            out[mq + 1] |= r >> (Integer::BlockBits - mr);
+
+        // Q < N + 2 and R 2^m + L <= N, so a few subtractions are enough.
+        if (this->c < 0) {
+            gear::add(out, w, h, w);
+        } else {
+            while (gear::compare(h, this->n.data(), w) >= 0)
+                gear::sub(h, w, this->n.data(), w);
+            gear::add(out, w, this->n.data(), w);
+            gear::sub(out, w, h, w);
+        }
+        while (gear::compare(out, this->n.data(), w) >= 0)
+            gear::sub(out, w, this->n.data(), w);
+    }
+};
+
+//
+// Mersenne and Proth numbers
+//
+std::optional<std::size_t> primality::get_mersenne_exponent(const Integer& n) {
+    const std::size_t p = n.most_significant_active_bit();
+    if (p == 0)
+        return std::nullopt;
+    const Integer::block_t* blocks = n.ref_blocks();
+    const std::size_t num_full = p / Integer::BlockBits;
+    for (std::size_t i = 0; i < num_full; i++) {
+        if (blocks[i] != std::numeric_limits<Integer::block_t>::max())
+            return std::nullopt;
+    }
+    const std::size_t rest = p % Integer::BlockBits;
+    if (rest != 0 && blocks[num_full] != (Integer::block_t(1) << rest) - 1)
+        return std::nullopt;
+    return p;
+}
+
+std::optional<primality::ProthForm> primality::get_proth_form(const Integer& n) {
+    if (!n.is_odd() || n <= constant::Two)
+        return std::nullopt;
+
+    // n - 1 differs from n only in the lowest bit.
+    const Integer::block_t* blocks = n.ref_blocks();
+    std::size_t i = 0;
+    Integer::block_t b = blocks[0] & ~Integer::block_t(1);
+    while (b == 0)
+        b = blocks[++i];
+    const std::size_t m = i * Integer::BlockBits + __builtin_ctzll(b);
+    if (n.most_significant_active_bit() - m > std::min<std::size_t>(m, Integer::BlockBits))
+        return std::nullopt;
+
+    const std::size_t mq = m / Integer::BlockBits;
+    const std::size_t mr = m % Integer::BlockBits;
+    Integer::block_t k = blocks[mq] >> mr;
+    if (mr != 0 && mq + 1 < n.get_num_blocks())
+        k |= blocks[mq + 1] << (Integer::BlockBits - mr);
+    return ProthForm{k, m};
+}
+
+bool primality::lucas_lehmer_test(const std::size_t p) {
+    if (p == 2)
+        return true;
+    if (p < 2 || !miller_rabin_test(static_cast<Integer::block_t>(p)))
+        return false;
+
+    // s(0) = 4, s(i+1) = s(i)^2 - 2
+    ShiftAddModulus mod(1, p, -1);
+    std::vector<Integer::block_t> s(mod.get_num_blocks(), 0);
+    s[0] = 4;
+    for (std::size_t i = 0; i < p - 2; i++) {
+        mod.square(s.data());
+        mod.sub(s.data(), 2);
+    }
+    return gear::is_all_zero(s.data(), s.size());
+}
+
+// a^(k 2^(m-1)) = -1 (mod n) for a quadratic non-residue a if and only if n is a prime.
+bool primality::proth_test(const Integer& n) {
+    const std::optional<ProthForm> form = get_proth_form(n);
+    if (!form)
+        throw std::invalid_argument("n must be k * 2^m + 1 with an odd k < 2^m");
+
+    for (const Integer::block_t a: get_small_primes()) {
+        if (Integer({a}) == n)
+            return true;
+        const int j = jacobi_symbol(static_cast<std::int64_t>(a), n);
+        if (j == 0)
+            return false;
+        if (j == 1)
+            continue;
+
+        ShiftAddModulus mod(form->k, form->m, 1);
+        std::vector<Integer::block_t> x(mod.get_num_blocks(), 0);
+        x[0] = 1;
+        for (int bit = get_bit_length(form->k) - 1; bit >= 0; bit--) {
+            mod.square(x.data());
+            if ((form->k >> bit) & 1)
+                mod.mul(x.data(), a);
+        }
+        for (std::size_t i = 1; i < form->m; i++)
+            mod.square(x.data());
+        return mod.is_minus_one(x.data());
+    }
+
+    // Only a square has no non-residue, and it is rejected by the Baillie-PSW test.
+    return bpsw_test(n);
+}
+
+//
+// Batch test
+//
+bool primality::test(const Integer& n, const Algorithm algorithm) {
+    switch (algorithm) {
+    case Algorithm::TrivialDivision:
+        return trivial_division(n);
+    case Algorithm::FermatTest:
+        return fermat_test(n, true);
+    case Algorithm::MillerRabinTest:
+        return miller_rabin_test(n, true);
+    case Algorithm::BpswTest:
+        return bpsw_test(n);
+    case Algorithm::LucasLehmerTest: {
+        const std::optional<std::size_t> p = get_mersenne_exponent(n);
+        if (!p)
+            throw std::invalid_argument("n must be 2^p - 1");
+        return lucas_lehmer_test(*p);
+    }
+    case Algorithm::ProthTest:
+        return proth_test(n);
+    case Algorithm::Auto:
+        if (const std::optional<std::size_t> p = get_mersenne_exponent(n))
+            return lucas_lehmer_test(*p);
+        if (get_proth_form(n))
+            return proth_test(n);
+        return bpsw_test(n);
+    }
+    throw std::invalid_argument("Unknown algorithm");
+}
+
+// The results are written to bytes because the elements of std::vector<bool>
+// share words and cannot be written by different threads.
+primality::BatchResult primality::test_many(std::span<const Integer> candidates,
+                                            const Algorithm algorithm,
+                                            const std::size_t num_threads) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::uint8_t> results(candidates.size());
+    ThreadPool pool(std::min(ThreadPool::resolve_num_threads(num_threads),
+                             std::max<std::size_t>(candidates.size(), 1)));
+    pool.run(candidates.size(), [&](const std::size_t i) {
+        results[i] = test(candidates[i], algorithm);
+    });
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    BatchResult result;
+    result.is_prime.assign(results.begin(), results.end());
+    result.num_threads = pool.get_num_threads();
+    result.elapsed = elapsed.count();
+    return result;
+}
+
 } // namespace grill
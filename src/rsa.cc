@@ -1,21 +1,112 @@
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <vector>
 #include "rsa.h"
 #include "constant.h"
+#include "ModInteger.h"
+#include "ModContextCache.h"
 #include "util.h"
+#include "ThreadPool.h"
+#include "batch_pow_mod.h"
 
 namespace grill {
 namespace rsa {
 
-Keys generate_keys(const std::size_t bit_length) {
-    Integer prime1 = util::get_random_prime(bit_length/2);
-    Integer prime2 = util::get_random_prime(bit_length/2);
-    Integer modulus = prime1 * prime2;
-    Integer phi = (prime1 - constant::One) * (prime2 - constant::One);
+static bool has_duplicate(const std::vector<Integer>& primes) {
+    for (std::size_t i = 0; i < primes.size(); i++) {
+        for (std::size_t j = i + 1; j < primes.size(); j++) {
+            if (primes[i] == primes[j])
+                return true;
+        }
+    }
+    return false;
+}
+
+// pub_key is a prime, so it is coprime to r - 1 unless it divides r - 1.
+static bool is_coprime_to_phi(const std::vector<Integer>& primes, const Integer& pub_key) {
+    for (const Integer& r: primes) {
+        if ((r - constant::One) % pub_key == constant::Zero)
+            return false;
+    }
+    return true;
+}
+
+void check_key_size(const std::size_t bit_length, const std::size_t num_primes) {
+    if (num_primes < 2)
+        throw std::invalid_argument("num_primes must be greater than or equal to 2");
+    if (bit_length / num_primes < MinPrimeBits)
+        throw std::invalid_argument("bit_length is too short for num_primes");
+}
+
+// The first bit_length % num_primes primes have one more bit than the others, so the bit
+// lengths of the primes sum up to bit_length.
+static std::vector<Integer> get_random_primes(const std::size_t bit_length,
+                                              const std::size_t num_primes,
+                                              const std::size_t num_threads) {
+    const std::size_t prime_bits = bit_length / num_primes;
+    const std::size_t num_longer = bit_length % num_primes;
+    std::vector<Integer> primes;
+    if (num_longer > 0)
+        primes = util::get_random_primes(prime_bits + 1, num_longer, num_threads);
+    for (Integer& r: util::get_random_primes(prime_bits, num_primes - num_longer, num_threads))
+        primes.emplace_back(std::move(r));
+    return primes;
+}
+
+static Integer get_product(const std::vector<Integer>& primes) {
+    Integer product(constant::One);
+    for (const Integer& r: primes)
+        product *= r;
+    return product;
+}
+
+Keys generate_keys(const std::size_t bit_length, const std::size_t num_threads,
+                   const std::size_t num_primes) {
+    check_key_size(bit_length, num_primes);
+
+    // The product of the primes can be shorter than bit_length by up to num_primes - 1
+    // bits, so the primes are searched again until it has bit_length bits.
     Integer pub_key = {0x10001};
+    std::vector<Integer> primes;
+    Integer modulus(constant::One);
+    do {
+        primes = get_random_primes(bit_length, num_primes, num_threads);
+        modulus = get_product(primes);
+    } while (static_cast<std::size_t>(modulus.most_significant_active_bit()) != bit_length ||
+             has_duplicate(primes) || !is_coprime_to_phi(primes, pub_key));
+
+    Integer phi(constant::One);
+    for (const Integer& r: primes)
+        phi *= r - constant::One;
     Integer priv_key = pub_key.inverse(phi);
 
+    // The coefficient of r_i is the inverse of the product of the preceding primes.
+    std::vector<OtherPrimeInfo> other_primes;
+    Integer product = primes[0] * primes[1];
+    for (std::size_t i = 2; i < num_primes; i++) {
+        Integer& r = primes[i];
+        Integer exponent = priv_key % (r - constant::One);
+        Integer coefficient = (product % r).inverse(r);
+        product *= r;
+        other_primes.emplace_back(OtherPrimeInfo{
+            std::move(r), std::move(exponent), std::move(coefficient),
+        });
+    }
+
+    Integer& prime1 = primes[0];
+    Integer& prime2 = primes[1];
+    Integer exponent1 = priv_key % (prime1 - constant::One);
+    Integer exponent2 = priv_key % (prime2 - constant::One);
+    Integer coefficient = prime2.inverse(prime1);
+
     return Keys {
         std::move(prime1), std::move(prime2), std::move(phi),
         std::move(modulus), std::move(pub_key), std::move(priv_key),
+        std::move(exponent1), std::move(exponent2), std::move(coefficient),
+        std::move(other_primes),
     };
 }
 
@@ -23,5 +114,121 @@ Integer compute(const Integer& exponent, const Integer& modulus, const Integer&
     return n.pow_mod(exponent, modulus);
 }
 
+// The contexts of prime1, prime2 and the other primes in this order, and the coefficients
+// of prime1 and the other primes in their contexts
+struct PrimeContexts {
+    std::vector<std::shared_ptr<const ModContext>> contexts;
+    std::vector<ModInteger> coefficients;
+};
+
+static PrimeContexts get_prime_contexts(const Keys& keys) {
+    ModContextCache& cache = ModContextCache::get_instance();
+    PrimeContexts contexts;
+    contexts.contexts = {cache.get(keys.prime1), cache.get(keys.prime2)};
+    contexts.coefficients.emplace_back(keys.coefficient, contexts.contexts[0]);
+    for (const OtherPrimeInfo& info: keys.other_primes) {
+        contexts.contexts.emplace_back(cache.get(info.prime));
+        contexts.coefficients.emplace_back(info.coefficient, contexts.contexts.back());
+    }
+    return contexts;
+}
+
+// h = (x - m) * coefficient mod r, where x and the coefficient are in the context of r.
+// m is reduced by the context, which doesn't need a long division even for m > r.
+static Integer calc_garner_coefficient(const ModInteger& x, const Integer& m,
+                                       const ModInteger& coefficient) {
+    const ModInteger h = (x - ModInteger(m, x.get_context())) * coefficient;
+    return h.to_Integer();
+}
+
+// m = m2 + q * (qInv * (m1 - m2) mod p), and m = m + R * ((m_i - m) * t_i mod r_i) for
+// each other prime, where R is the product of the preceding primes. h is calculated by
+// the contexts of the primes instead of a long division.
+static Integer compute_private(const Keys& keys, const Integer& n,
+                               const PrimeContexts& contexts) {
+    const auto& prime_contexts = contexts.contexts;
+    const ModInteger m1 = ModInteger::pow(n, keys.exponent1, prime_contexts[0]);
+    const Integer m2 = prime_contexts[1]->pow(n, keys.exponent2);
+    Integer m = m2 + calc_garner_coefficient(m1, m2, contexts.coefficients[0]) * keys.prime2;
+
+    Integer product = keys.prime1 * keys.prime2;
+    for (std::size_t i = 0; i < keys.other_primes.size(); i++) {
+        const OtherPrimeInfo& info = keys.other_primes[i];
+        const ModInteger mi = ModInteger::pow(n, info.exponent, prime_contexts[i + 2]);
+        m += calc_garner_coefficient(mi, m, contexts.coefficients[i + 1]) * product;
+        product *= info.prime;
+    }
+    return m;
+}
+
+Integer compute_private(const Keys& keys, const Integer& n) {
+    return compute_private(keys, n, get_prime_contexts(keys));
+}
+
+//
+// Batch
+//
+// The messages are divided into tasks of batch_size. At most queue_size tasks are
+// queued, and the oldest one is waited for before the next is queued. compute_task
+// returns the results of the messages of a task.
+template<typename F>
+static std::vector<Integer> run_batch(std::span<const Integer> messages,
+                                      const BatchOptions& options, const F& compute_task) {
+    if (options.batch_size == 0)
+        throw std::invalid_argument("batch_size must be greater than 0");
+
+    std::vector<Integer> results(messages.size(), constant::Zero);
+    ThreadPool pool(options.num_threads);
+    const std::size_t queue_size =
+      (options.queue_size > 0) ? options.queue_size : 2 * pool.get_num_threads();
+    std::deque<std::future<void>> pending;
+    for (std::size_t begin = 0; begin < messages.size(); begin += options.batch_size) {
+        if (pending.size() == queue_size) {
+            pending.front().get();
+            pending.pop_front();
+        }
+        const std::size_t end = std::min(begin + options.batch_size, messages.size());
+        pending.emplace_back(pool.submit([&, begin, end] {
+            std::vector<Integer> task_results = compute_task(messages.subspan(begin, end - begin));
+            std::move(task_results.begin(), task_results.end(), results.begin() + begin);
+        }));
+    }
+    for (auto& future: pending)
+        future.get();
+    return results;
+}
+
+std::vector<Integer> compute_batch(const Integer& exponent, const Integer& modulus,
+                                   std::span<const Integer> messages,
+                                   const BatchOptions& options) {
+    const auto context = ModContextCache::get_instance().get(modulus);
+    if (!modulus.is_odd() || modulus == constant::One) {
+        return run_batch(messages, options, [&](std::span<const Integer> task_messages) {
+            std::vector<Integer> results;
+            for (const Integer& n: task_messages)
+                results.emplace_back(context->pow(n, exponent));
+            return results;
+        });
+    }
+
+    // The messages of a task are advanced in the lanes of batch_pow_mod. The limbs of the
+    // modulus and R^2 are precomputed once by the context.
+    const Integer exponents[] = {exponent};
+    return run_batch(messages, options, [&](std::span<const Integer> task_messages) {
+        return batch_pow_mod::calc(task_messages, exponents, *context);
+    });
+}
+
+std::vector<Integer> compute_private_batch(const Keys& keys, std::span<const Integer> messages,
+                                           const BatchOptions& options) {
+    const PrimeContexts contexts = get_prime_contexts(keys);
+    return run_batch(messages, options, [&](std::span<const Integer> task_messages) {
+        std::vector<Integer> results;
+        for (const Integer& n: task_messages)
+            results.emplace_back(compute_private(keys, n, contexts));
+        return results;
+    });
+}
+
 } // namespace rsa
 } // namespace grill
@@ -1,27 +1,49 @@
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <stdexcept>
 #include <random>
+#include <vector>
+#include <optional>
 #include "constant.h"
 #include "util.h"
 #include "primality.h"
+#include "ThreadPool.h"
 
 namespace grill {
 
-struct IntegerGenerator : public Integer {
-    IntegerGenerator(const std::size_t n_blk, const block_t* const src)
-    : Integer(n_blk) {
-        gear::copy(this->get_blocks(), src, n_blk);
+static int count_trailing_zeros(const Integer& n) {
+    const Integer::block_t* blocks = n.ref_blocks();
+    for (std::size_t i = 0; i < n.get_num_blocks(); i++) {
+        if (blocks[i] != 0)
+            return i * Integer::BlockBits + __builtin_ctzll(blocks[i]);
     }
-};
-
-// a should be greater than or equal to  b
-static Integer calc_gcd(const Integer& a, const Integer& b) {
-    const Integer r = a % b;
-    return (r == constant::Zero) ? b : calc_gcd(b, r);
+    return 0;
 }
 
+// Binary GCD. Only shifts and subtractions are used, which are much faster than
+// the Euclidean algorithm with the bitwise division.
 Integer util::gcd(const Integer& a, const Integer& b) {
-    return (a >= b) ? calc_gcd(a, b) : calc_gcd(b, a);
+    if (a.is_zero())
+        return b;
+    if (b.is_zero())
+        return a;
+
+    const int za = count_trailing_zeros(a);
+    const int zb = count_trailing_zeros(b);
+    Integer x(a);
+    Integer y(b);
+    x >>= za;
+    y >>= zb;
+    Integer* u = &x; // odd
+    Integer* v = &y; // odd or zero
+    while (!v->is_zero()) {
+        *v >>= count_trailing_zeros(*v);
+        if (*u >= *v)
+            std::swap(u, v);
+        *v -= *u;
+    }
+    return *u * Integer::pow2(std::min(za, zb));
 }
 
 std::string util::to_string(const bool b) {
@@ -72,7 +94,7 @@ static Integer hex_str_to_Integer(const std::string& hex_str) {
     for (std::size_t i = 1; i < num_blocks; i++)
         fill_block(i, str_len_per_block);
 
-    return IntegerGenerator(num_blocks, blocks);
+    return Integer::from_blocks(blocks, num_blocks);
 }
 
 static Integer hex_str_with_prefix_to_Integer(const std::string& s) {
@@ -114,22 +136,121 @@ Integer util::get_random(const std::size_t bit_length) {
         const std::size_t shift_bits = Integer::BlockBits - remaining_bits;
         buf[num_blocks-1] >>= shift_bits;
     }
-    return IntegerGenerator(num_blocks, buf);
+    return Integer::from_blocks(buf, num_blocks);
 }
 
-Integer util::get_random_prime(const std::size_t bit_length) {
-    if (bit_length <= 2)
-        throw std::invalid_argument("bit_length must be greater than 2");
+//
+// Incremental search of a prime number
+//
+// The number of odd candidates sieved at once
+static constexpr std::size_t PrimeSearchWindow = 4096;
 
-    Integer n = constant::Zero;
-    while (true) {
-        n = get_random(bit_length);
-        if (n <= constant::Two)
+// Marks i such that start + 2i has a small prime factor, where residues are start mod the
+// small primes. A small prime itself is not marked.
+static std::vector<bool> sieve_window(const Integer& start,
+                                      const std::vector<Integer::block_t>& residues) {
+    const auto& primes = primality::get_small_primes();
+    const bool small_start = start <= Integer({primality::SmallFactorLimit});
+    const Integer::block_t start0 = start.ref_blocks()[0];
+
+    std::vector<bool> composite(PrimeSearchWindow, false);
+    for (std::size_t k = 1; k < primes.size(); k++) { // start is odd, so 2 is skipped
+        const Integer::block_t p = primes[k];
+        // r + 2i = 0 (mod p) => i = -r * 2^-1 (mod p), where 2^-1 = (p + 1) / 2
+        std::size_t i = ((p - residues[k]) % p) * ((p + 1) / 2) % p;
+        if (small_start && start0 + 2 * i == p)
+            i += p;
+        for (; i < PrimeSearchWindow; i += p)
+            composite[i] = true;
+    }
+    return composite;
+}
+
+static void advance_residues(std::vector<Integer::block_t>& residues, const Integer::block_t d) {
+    const auto& primes = primality::get_small_primes();
+    for (std::size_t k = 0; k < primes.size(); k++)
+        residues[k] = (residues[k] + d) % primes[k];
+}
+
+// The survivors of the sieve in the window from start are tested. The candidates whose
+// most significant bit is over max_bit are not tested.
+static std::optional<Integer> search_window(const Integer& start,
+                                            const std::vector<Integer::block_t>& residues,
+                                            const int max_bit,
+                                            const std::atomic<bool>& cancelled) {
+    const std::vector<bool> composite = sieve_window(start, residues);
+    for (std::size_t i = 0; i < PrimeSearchWindow; i++) {
+        if (composite[i])
             continue;
-        if (primality::miller_rabin_test(n))
+        if (cancelled)
             break;
+        Integer n = start + Integer({2 * i});
+        if (n.most_significant_active_bit() > max_bit)
+            break;
+        if (n == constant::One)
+            continue;
+        if (primality::bpsw_test(n))
+            return n;
     }
-    return n;
+    return std::nullopt;
+}
+
+// A random odd start with the top bit set is sieved by the small primes window by window,
+// so a found prime has exactly bit_length bits. Its residues are calculated only once and
+// updated for each window. No value is returned when it is cancelled.
+static std::optional<Integer> search_random_prime(const std::size_t bit_length,
+                                                  const std::atomic<bool>& cancelled) {
+    const int max_bit = bit_length;
+    while (!cancelled) {
+        Integer start = util::get_random(bit_length);
+        start.set_bit_value(0, true);
+        start.set_bit_value(bit_length - 1, true);
+        std::vector<Integer::block_t> residues = primality::get_small_prime_residues(start);
+        while (!cancelled && start.most_significant_active_bit() <= max_bit) {
+            std::optional<Integer> n = search_window(start, residues, max_bit, cancelled);
+            if (n)
+                return n;
+            start += Integer({2 * PrimeSearchWindow});
+            advance_residues(residues, 2 * PrimeSearchWindow);
+        }
+    }
+    return std::nullopt;
+}
+
+Integer util::get_random_prime(const std::size_t bit_length) {
+    if (bit_length <= 2)
+        throw std::invalid_argument("bit_length must be greater than 2");
+
+    const std::atomic<bool> never_cancelled(false);
+    return std::move(*search_random_prime(bit_length, never_cancelled));
+}
+
+// Every worker searches from its own random starts, and a found prime fills the next
+// empty slot. The candidates being tested by the other workers are abandoned when
+// the last slot is filled.
+std::vector<Integer> util::get_random_primes(const std::size_t bit_length,
+                                             const std::size_t count,
+                                             const std::size_t num_threads) {
+    if (bit_length <= 2)
+        throw std::invalid_argument("bit_length must be greater than 2");
+
+    std::vector<Integer> primes;
+    std::mutex primes_mutex;
+    std::atomic<bool> done(count == 0);
+    ThreadPool pool(num_threads);
+    pool.run(pool.get_num_threads(), [&](const std::size_t) {
+        while (!done) {
+            std::optional<Integer> n = search_random_prime(bit_length, done);
+            if (!n)
+                return;
+            std::lock_guard<std::mutex> lock(primes_mutex);
+            if (primes.size() < count)
+                primes.emplace_back(std::move(*n));
+            if (primes.size() == count)
+                done = true;
+        }
+    });
+    return primes;
 }
 
 } // namespace grill
@@ -46,4 +46,30 @@ BOOST_AUTO_TEST_CASE(multiple_size)
     allocator.free(blocks2);
 }
 
+BOOST_AUTO_TEST_CASE(over_default_table_size)
+{
+    BlockAllocator<Integer::block_t> allocator;
+    Integer::block_t *blocks1 = allocator.take(1000);
+    BOOST_TEST(blocks1 != nullptr);
+    allocator.free(blocks1);
+
+    Integer::block_t *blocks2 = allocator.take(1000);
+    BOOST_TEST(blocks1 == blocks2);
+    allocator.free(blocks2);
+}
+
+BOOST_AUTO_TEST_CASE(release_caches)
+{
+    BlockAllocator<Integer::block_t> allocator;
+    Integer::block_t *blocks1 = allocator.take(1);
+    Integer::block_t *blocks2 = allocator.take(1000);
+    allocator.free(blocks1);
+    allocator.release_caches();
+    allocator.free(blocks2);
+
+    Integer::block_t *blocks3 = allocator.take(1000);
+    BOOST_TEST(blocks3 == blocks2);
+    allocator.free(blocks3);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
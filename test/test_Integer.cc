@@ -343,4 +343,99 @@ BOOST_DATA_TEST_CASE(is_zero, is_zero_samples)
     BOOST_TEST(sample.n.is_zero() == sample.expected);
 }
 
+BOOST_AUTO_TEST_CASE(reserve_and_shrink_to_fit)
+{
+    Integer n({1, 2, 3});
+    BOOST_TEST(n.get_capacity() == 3);
+
+    n.reserve(10);
+    BOOST_TEST(n.get_capacity() == 10);
+    n.reserve(5);
+    BOOST_TEST(n.get_capacity() == 10);
+    const Integer::block_t expected[] = {3, 2, 1};
+    BOOST_TEST(create_block_vector(n) == expected, boost::test_tools::per_element());
+
+    n.shrink_to_fit();
+    BOOST_TEST(n.get_capacity() == 3);
+    BOOST_TEST(create_block_vector(n) == expected, boost::test_tools::per_element());
+
+    n -= Integer({1, 2, 0});
+    BOOST_TEST(n.get_num_blocks() == 1);
+    n.shrink_to_fit();
+    BOOST_TEST(n.get_capacity() == Integer::NumInlineBlocks);
+    BOOST_TEST(n == Integer({3}));
+}
+
+BOOST_AUTO_TEST_CASE(compound_assignments_in_capacity)
+{
+    Integer n({1});
+    n.reserve(8);
+    const Integer::block_t* blocks = n.ref_blocks();
+
+    n += Integer({0xffff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff});
+    BOOST_TEST(n == Integer({1, 0, 0}));
+    n *= Integer({1, 0, 0});
+    BOOST_TEST(n == Integer({1, 0, 0, 0, 0}));
+    n.set_bit_value(7 * Integer::BlockBits, true);
+    n -= Integer({1, 0, 0, 0, 0});
+    BOOST_TEST(n == Integer({1, 0, 0, 0, 0, 0, 0, 0}));
+    n %= Integer({3});
+    BOOST_TEST(n == Integer({1}));
+    n.set_bit_value(5 * Integer::BlockBits, true);
+    n /= Integer({1, 0});
+    BOOST_TEST(n == Integer({1, 0, 0, 0, 0}));
+    BOOST_TEST(n.ref_blocks() == blocks);
+    BOOST_TEST(n.get_capacity() == 8);
+}
+
+BOOST_AUTO_TEST_CASE(compound_assignments_with_itself)
+{
+    Integer n({1, 2});
+    n += n;
+    BOOST_TEST(n == Integer({2, 4}));
+    n *= n;
+    BOOST_TEST(n == Integer({4, 16, 16}));
+    n -= n;
+    BOOST_TEST(n.is_zero());
+
+    Integer m({5, 6});
+    m %= m;
+    BOOST_TEST(m.is_zero());
+    Integer d({5, 6});
+    d /= d;
+    BOOST_TEST(d == constant::One);
+}
+
+BOOST_AUTO_TEST_CASE(set_bit_value_grows_capacity)
+{
+    Integer n({0});
+    n.set_bit_value(3 * Integer::BlockBits, true);
+    BOOST_TEST(n.get_num_blocks() == 4);
+    BOOST_TEST(n.get_capacity() == 4);
+    n.set_bit_value(4 * Integer::BlockBits, true);
+    BOOST_TEST(n.get_num_blocks() == 5);
+    BOOST_TEST(n.get_capacity() == 8);
+}
+
+BOOST_AUTO_TEST_CASE(from_blocks)
+{
+    const Integer::block_t blocks[] = {1, 2, 0, 0};
+    const Integer n = Integer::from_blocks(blocks, 4);
+    BOOST_TEST(n.get_num_blocks() == 4);
+    BOOST_TEST(n == Integer({2, 1}));
+
+    const std::size_t num_active = gear::get_num_active_blocks(blocks, 4);
+    BOOST_TEST(num_active == 2);
+    BOOST_TEST(Integer::from_blocks(blocks, num_active).get_num_blocks() == 2);
+
+    const Integer wide = Integer::from_blocks(blocks, 2, 5);
+    BOOST_TEST(wide.get_num_blocks() == 5);
+    BOOST_TEST(wide == Integer({2, 1}));
+    const Integer narrow = Integer::from_blocks(blocks, 2, 1);
+    BOOST_TEST(narrow == Integer({1}));
+
+    const Integer::block_t zero[] = {0, 0, 0};
+    BOOST_TEST(gear::get_num_active_blocks(zero, 3) == 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
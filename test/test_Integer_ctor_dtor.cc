@@ -44,15 +44,73 @@ BOOST_AUTO_TEST_CASE(copy_constructor)
     BOOST_TEST(n2.ref_blocks() != nullptr);
 }
 
+BOOST_AUTO_TEST_CASE(copy_constructor_with_large_value)
+{
+    const Integer n1({1, 2, 3, 4});
+    const auto n2(n1);
+
+    BOOST_TEST(create_block_vector(n2) == create_block_vector(n1), boost::test_tools::per_element());
+    BOOST_TEST(n1.ref_blocks() != n2.ref_blocks());
+}
+
 BOOST_AUTO_TEST_CASE(move_constructor)
 {
-    Integer n1({123});
+    // The blocks of a large value are taken from the allocator and moved.
+    Integer n1({1, 2, 3, 4});
     const auto n1_ref_blocks = n1.ref_blocks();
     const auto n2(std::move(n1));
 
-    BOOST_TEST(n2.ref_blocks()[0] == 123);
+    const Integer::block_t expected[] = {4, 3, 2, 1};
+    BOOST_TEST(create_block_vector(n2) == expected, boost::test_tools::per_element());
     BOOST_TEST(n1_ref_blocks == n2.ref_blocks());
     BOOST_TEST(n1.ref_blocks() == nullptr);
 }
 
+BOOST_AUTO_TEST_CASE(move_constructor_with_inline_value)
+{
+    Integer n1({123, 456});
+    const auto n2(std::move(n1));
+
+    const Integer::block_t expected[] = {456, 123};
+    BOOST_TEST(create_block_vector(n2) == expected, boost::test_tools::per_element());
+    BOOST_TEST(n1.ref_blocks() != n2.ref_blocks());
+    BOOST_TEST(create_block_vector(n1) == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(move_assignment_to_moved_from_object)
+{
+    Integer n1({123});
+    Integer n2({456});
+    std::swap(n1, n2);
+
+    BOOST_TEST(n1.ref_blocks()[0] == 456);
+    BOOST_TEST(n2.ref_blocks()[0] == 123);
+}
+
+BOOST_AUTO_TEST_CASE(move_assignment_between_inline_and_large_values)
+{
+    Integer n1({123});
+    Integer n2({1, 2, 3, 4});
+    std::swap(n1, n2);
+
+    const Integer::block_t expected[] = {4, 3, 2, 1};
+    BOOST_TEST(create_block_vector(n1) == expected, boost::test_tools::per_element());
+    BOOST_TEST(n2.get_num_blocks() == 1);
+    BOOST_TEST(n2.ref_blocks()[0] == 123);
+
+    n1 = std::move(n2);
+    BOOST_TEST(n1.get_num_blocks() == 1);
+    BOOST_TEST(n1.ref_blocks()[0] == 123);
+}
+
+BOOST_AUTO_TEST_CASE(move_assignment_to_itself)
+{
+    Integer n1({1, 2, 3, 4});
+    Integer& n2 = n1;
+    n1 = std::move(n2);
+
+    const Integer::block_t expected[] = {4, 3, 2, 1};
+    BOOST_TEST(create_block_vector(n1) == expected, boost::test_tools::per_element());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
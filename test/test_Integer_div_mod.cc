@@ -52,6 +52,16 @@ BOOST_AUTO_TEST_CASE(div_by_zero)
     BOOST_CHECK_THROW(constant::One / constant::Zero, std::out_of_range);
 }
 
+BOOST_AUTO_TEST_CASE(div_assign_by_zero)
+{
+    Integer a({12345});
+    BOOST_CHECK_THROW(a /= constant::Zero, std::out_of_range);
+    BOOST_TEST(a == Integer({12345}));
+    Integer b({1, 2, 3});
+    BOOST_CHECK_THROW(b %= constant::Zero, std::out_of_range);
+    BOOST_TEST(b == Integer({1, 2, 3}));
+}
+
 static binary_op_sample_t mod_operator_samples[] {
     {Integer({0}),  Integer({1}),  Integer({0})},
     {Integer({1}),  Integer({1}),  Integer({0})},
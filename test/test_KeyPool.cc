@@ -0,0 +1,78 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include "constant.h"
+#include "KeyPool.h"
+
+using namespace grill;
+
+BOOST_AUTO_TEST_SUITE(test_suite_KeyPool)
+
+static void check_keys(const rsa::Keys& keys, const std::size_t num_primes) {
+    BOOST_TEST(keys.other_primes.size() == num_primes - 2);
+    const Integer n({0x1234'5678});
+    const Integer encrypted = rsa::compute(keys.public_exponent, keys.modulus, n);
+    BOOST_TEST(rsa::compute_private(keys, encrypted) == n);
+}
+
+static const std::size_t num_threads_samples[] = {1, 2};
+
+BOOST_DATA_TEST_CASE(take, num_threads_samples)
+{
+    rsa::KeyPool pool({{256, 2}, {512, 1, 3}}, sample);
+    for (int i = 0; i < 3; i++)
+        check_keys(pool.take(256), 2);
+    check_keys(pool.take(512), 3);
+
+    const rsa::KeyPool::Metrics metrics = pool.get_metrics(256);
+    BOOST_TEST(metrics.capacity == 2);
+    BOOST_TEST(metrics.num_taken == 3);
+    BOOST_TEST(metrics.num_generated >= 3);
+    BOOST_TEST(metrics.depth <= 2);
+    BOOST_TEST(metrics.refill_rate > 0);
+}
+
+BOOST_AUTO_TEST_CASE(try_take)
+{
+    rsa::KeyPool pool({{256, 1}});
+    pool.take(256);
+    std::optional<rsa::Keys> keys;
+    while (!(keys = pool.try_take(256)))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    check_keys(*keys, 2);
+
+    const rsa::KeyPool::Metrics metrics = pool.get_metrics(256);
+    BOOST_TEST(metrics.num_taken == 2);
+    BOOST_TEST(metrics.num_waits <= 1);
+}
+
+BOOST_AUTO_TEST_CASE(fill)
+{
+    rsa::KeyPool pool({{256, 3}});
+    while (pool.get_metrics(256).depth < 3)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    const rsa::KeyPool::Metrics metrics = pool.get_metrics(256);
+    BOOST_TEST(metrics.num_generated == 3);
+    BOOST_TEST(metrics.num_waits == 0);
+}
+
+BOOST_AUTO_TEST_CASE(unknown_bit_length)
+{
+    rsa::KeyPool pool({{256, 1}});
+    BOOST_CHECK_THROW(pool.take(512), std::invalid_argument);
+    BOOST_CHECK_THROW(pool.try_take(512), std::invalid_argument);
+    BOOST_CHECK_THROW(pool.get_metrics(512), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(invalid_specs)
+{
+    BOOST_CHECK_THROW(rsa::KeyPool({{256, 0}}), std::invalid_argument);
+    BOOST_CHECK_THROW(rsa::KeyPool({{256, 1}, {256, 2}}), std::invalid_argument);
+    BOOST_CHECK_THROW(rsa::KeyPool({{4, 1}}), std::invalid_argument);
+    BOOST_CHECK_THROW(rsa::KeyPool({{256, 1, 1}}), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,110 @@
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+#include "ModContextCache.h"
+#include "constant.h"
+
+using namespace grill;
+
+struct cache_fixture {
+    ModContextCache& cache = ModContextCache::get_instance();
+
+    cache_fixture() {
+        cache.clear();
+    }
+
+    ~cache_fixture() {
+        cache.set_capacity(ModContextCache::DefaultCapacity);
+        cache.clear();
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(test_suite_ModContextCache, cache_fixture)
+
+BOOST_AUTO_TEST_CASE(hit_and_miss)
+{
+    const auto ctx1 = cache.get(Integer({101}));
+    BOOST_TEST(cache.get_num_misses() == 1);
+    BOOST_TEST(cache.get_num_hits() == 0);
+
+    const auto ctx2 = cache.get(Integer({0, 101}));
+    BOOST_TEST(ctx1 == ctx2);
+    BOOST_TEST(cache.get_num_misses() == 1);
+    BOOST_TEST(cache.get_num_hits() == 1);
+    BOOST_TEST(cache.get_size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(evict_least_recently_used)
+{
+    cache.set_capacity(2);
+    const auto ctx1 = cache.get(Integer({101}));
+    const auto ctx2 = cache.get(Integer({103}));
+    cache.get(Integer({101}));
+    cache.get(Integer({107})); // 103 is evicted
+    BOOST_TEST(cache.get_size() == 2);
+
+    BOOST_TEST(cache.get(Integer({101})) == ctx1);
+    BOOST_TEST(cache.get(Integer({103})) != ctx2);
+    BOOST_TEST(cache.get_num_hits() == 2);
+    BOOST_TEST(cache.get_num_misses() == 4);
+}
+
+BOOST_AUTO_TEST_CASE(shrink_capacity)
+{
+    cache.get(Integer({101}));
+    cache.get(Integer({103}));
+    cache.get(Integer({107}));
+    cache.set_capacity(1);
+    BOOST_TEST(cache.get_capacity() == 1);
+    BOOST_TEST(cache.get_size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+    cache.set_capacity(0);
+    BOOST_TEST(cache.get(Integer({101}))->get_modulus() == Integer({101}));
+    BOOST_TEST(cache.get_size() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(pow_mod_uses_cache)
+{
+    const Integer mod({0x7fff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff});
+    BOOST_TEST(Integer({3}).pow_mod(Integer({4}), mod) == Integer({81}));
+    BOOST_TEST(Integer({2}).pow_mod(Integer({10}), mod) == Integer({1024}));
+    BOOST_TEST(cache.get_num_misses() == 1);
+    BOOST_TEST(cache.get_num_hits() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(multiple_threads)
+{
+    constexpr int NumThreads = 4;
+    constexpr int NumLoops = 100;
+    cache.set_capacity(2);
+
+    std::vector<std::thread> threads;
+    std::vector<int> num_failures(NumThreads, 0);
+    for (int i = 0; i < NumThreads; i++) {
+        threads.emplace_back([i, &num_failures] {
+            // Moduli that fit in a block don't use the cache.
+            const Integer mods[] = {
+                Integer({0x1ff'ffff, 0xffff'ffff'ffff'ffff}),         // M89
+                Integer({0x7ff'ffff'ffff, 0xffff'ffff'ffff'ffff}),    // M107
+                Integer({0x7fff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff}), // M127
+            };
+            for (int j = 0; j < NumLoops; j++) {
+                const Integer& mod = mods[(i + j) % 3];
+                if (constant::Two.pow_mod(mod - constant::One, mod) != constant::One)
+                    num_failures[i]++;
+            }
+        });
+    }
+    for (auto& thread: threads)
+        thread.join();
+
+    for (const int n: num_failures)
+        BOOST_TEST(n == 0);
+    BOOST_TEST(cache.get_num_hits() + cache.get_num_misses() == NumThreads * NumLoops);
+    BOOST_TEST(cache.get_size() <= 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,365 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <algorithm>
+#include <memory>
+#include "ModInteger.h"
+#include "constant.h"
+#include "sample_types.h"
+#include "util.h"
+
+using namespace grill;
+
+BOOST_AUTO_TEST_SUITE(test_suite_ModInteger)
+
+// Moduli: 101, 100, 2^127-1, 2^127+2^64+6 and 2^128-59.
+// Both Montgomery (odd) and Barrett (even) contexts, and a modulus without a room for
+// lazy reduction are covered.
+static binary_mod_op_sample_t add_samples[] = {
+    {Integer({0x4f}), Integer({0x20}), Integer({0x65}), Integer({0xa})},
+    {Integer({0x5e}), Integer({0x2d}), Integer({0x64}), Integer({0x27})},
+    {Integer({0x6bb6a198f1446bea, 0xb0c11fdecb91ce37}),
+     Integer({0x43d85892ec1d7da0, 0xa6eb8c9ebd69fe29}),
+     Integer({0x7fffffffffffffff, 0xffffffffffffffff}),
+     Integer({0x2f8efa2bdd61e98b, 0x57acac7d88fbcc61})},
+    {Integer({0xd464138a6233255, 0x3fc1ea36f17fd374}),
+     Integer({0x5f2dd97f1cfb10f6, 0x2827688de6a16a3b}),
+     Integer({0x8000000000000001, 6}),
+     Integer({0x6c741ab7c31e434b, 0x67e952c4d8213daf})},
+    {Integer({0x617959ce3f1f65a8, 0xde5271007814e8a2}),
+     Integer({0x3fd4235992edcf45, 0x1a1afe878b33e968}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0xa14d7d27d20d34ed, 0xf86d6f880348d20a})},
+};
+
+BOOST_DATA_TEST_CASE(add, add_samples)
+{
+    const auto context = std::make_shared<ModContext>(sample.mod);
+    ModInteger a(sample.lhs, context);
+    const ModInteger b(sample.rhs, context);
+    BOOST_TEST((a + b).to_Integer() == sample.expected);
+    a += b;
+    BOOST_TEST(a.to_Integer() == sample.expected);
+}
+
+static binary_mod_op_sample_t sub_samples[] = {
+    {Integer({1}), Integer({0x5d}), Integer({0x65}), Integer({9})},
+    {Integer({0x1b}), Integer({0x34}), Integer({0x64}), Integer({0x4b})},
+    {Integer({0x6f08e64eea959c21, 0x2e9c82b1478c281d}),
+     Integer({0x6186c5bb28dbd25e, 0x63b229f1c4069545}),
+     Integer({0x7fffffffffffffff, 0xffffffffffffffff}),
+     Integer({0xd822093c1b9c9c2, 0xcaea58bf838592d8})},
+    {Integer({0x21da8978206f5c66, 0x71e0c07e9e115e4b}),
+     Integer({0x15c33b2df1461aa, 0xf8eb18b900745130}),
+     Integer({0x8000000000000001, 6}),
+     Integer({0x207e55c5415afabb, 0x78f5a7c59d9d0d1b})},
+    {Integer({0xf5cae3bf3729c619, 0xc60a3cab359eeefb}),
+     Integer({0x2a9eba0cdf561d80, 0x2a759159fb7ff337}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0xcb2c29b257d3a899, 0x9b94ab513a1efbc4})},
+};
+
+BOOST_DATA_TEST_CASE(sub, sub_samples)
+{
+    const auto context = std::make_shared<ModContext>(sample.mod);
+    ModInteger a(sample.lhs, context);
+    const ModInteger b(sample.rhs, context);
+    BOOST_TEST((a - b).to_Integer() == sample.expected);
+    a -= b;
+    BOOST_TEST(a.to_Integer() == sample.expected);
+}
+
+static binary_mod_op_sample_t mul_samples[] = {
+    {Integer({0x25}), Integer({0x28}), Integer({0x65}), Integer({0x42})},
+    {Integer({0x19}), Integer({0x45}), Integer({0x64}), Integer({0x19})},
+    {Integer({0x1a363715a02fdaa1, 0xad864c44e049548e}),
+     Integer({0x5866f48bf7f35634, 0xf0e3cd972e81d66d}),
+     Integer({0x7fffffffffffffff, 0xffffffffffffffff}),
+     Integer({0x53ecf032c2867fcc, 0x3238b734ca4a7cf9})},
+    {Integer({0x5c76f18a0585a01c, 0x4c7d6df0621aef57}),
+     Integer({0x254cb864ef901b93, 0x2a7c18806a375391}),
+     Integer({0x8000000000000001, 6}),
+     Integer({0x466eb301cd1ad0ed, 0x4097e65c3e7e495b})},
+    {Integer({0x4d25deb354f46a69, 0x10acff0043892dfc}),
+     Integer({0xddb74d960d5a8f, 0x9a656aafd1412584}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0xa2d38ab4a72944e, 0xc0fc0288d966e80e})},
+};
+
+BOOST_DATA_TEST_CASE(mul, mul_samples)
+{
+    const auto context = std::make_shared<ModContext>(sample.mod);
+    ModInteger a(sample.lhs, context);
+    const ModInteger b(sample.rhs, context);
+    BOOST_TEST((a * b).to_Integer() == sample.expected);
+    BOOST_TEST(a.square().to_Integer() == (sample.lhs * sample.lhs) % sample.mod);
+    a *= b;
+    BOOST_TEST(a.to_Integer() == sample.expected);
+}
+
+static binary_mod_op_sample_t pow_samples[] = {
+    {Integer({0x27}), Integer({0}), Integer({0x65}), Integer({1})},
+    {Integer({0x3d}), Integer({1}), Integer({0x65}), Integer({0x3d})},
+    {Integer({0x59}), Integer({0x10001}), Integer({0x65}), Integer({0x3d})},
+    {Integer({0x28}),
+     Integer({0xb5, 0x4f59672710e6d8e6, 0x568068b9b52a43ab, 0xad8d194a98921396}),
+     Integer({0x65}), Integer({0x1e})},
+    {Integer({2}), Integer({0}), Integer({0x64}), Integer({1})},
+    {Integer({0x5f}), Integer({1}), Integer({0x64}), Integer({0x5f})},
+    {Integer({0x2d}), Integer({0x10001}), Integer({0x64}), Integer({0x19})},
+    {Integer({0x33}),
+     Integer({0x83, 0xe979cf32d1634b4, 0xb465325278f845f5, 0x7b3120df2f4d4c86}),
+     Integer({0x64}), Integer({1})},
+    {Integer({0x23495d0157079670, 0x25f02628eb07c30d}),
+     Integer({0x10001}),
+     Integer({0x7fffffffffffffff, 0xffffffffffffffff}),
+     Integer({0x76c9da79d06107cd, 0x23be47cebbc8e37c})},
+    {Integer({0xbc90f368b8e8f4e, 0xb3de08f9ec983704}),
+     Integer({0xdd, 0x960afe94bbdbb01, 0xdc14ed575e0730b3, 0xcc170c31c7eec61b}),
+     Integer({0x7fffffffffffffff, 0xffffffffffffffff}),
+     Integer({0x1fb59131784fc36d, 0x7bf1281e9c27e52d})},
+    {Integer({0x74a677c6400db00d, 0xd3881a5058056ed0}),
+     Integer({0x10001}),
+     Integer({0x8000000000000001, 6}),
+     Integer({0x53e228698e11a913, 0x6ebf4310f566c7b2})},
+    {Integer({0xe42d43c2547f19c, 0x6bf84914a6a5bc99}),
+     Integer({0x28, 0xcc7c6d812d6f2efc, 0x4e613a365119cdcc, 0xaf9b74f84ffcbf42}),
+     Integer({0x8000000000000001, 6}),
+     Integer({0x7c47cb73c84d4ea4, 0x71cebb6d20f1bad5})},
+    {Integer({0x69f0441ec9bafe62, 0xe580c35ea161d909}),
+     Integer({0x10001}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0x67a78fc953b7132d, 0x19f0e5c6c2dca118})},
+    {Integer({0x5f7cc5d86f3f0240, 0x2b37d8171b4c24c2}),
+     Integer({0xab, 0x7e5a3930cd39e158, 0x8606af8a36939ef, 0xea83854afaa30fac}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0xa09ba28b4d54998e, 0xe977c10b65b9af8c})},
+    // The bit length 65 of the base must not be taken as a small base.
+    {Integer({1, 5}),
+     Integer({3}),
+     Integer({0x7fffffffffffffff, 0xffffffffffffffff}),
+     Integer({0x4d, 0x9b})},
+};
+
+BOOST_DATA_TEST_CASE(pow, pow_samples)
+{
+    const auto context = std::make_shared<ModContext>(sample.mod);
+    BOOST_TEST(ModInteger(sample.lhs, context).pow(sample.rhs).to_Integer() == sample.expected);
+    BOOST_TEST(context->pow(sample.lhs, sample.rhs) == sample.expected);
+}
+
+static const std::size_t large_modulus_bits_samples[] = {255, 256, 520, 1024, 2048, 4096};
+
+// The results are compared with the binary method by mul() of the context.
+BOOST_DATA_TEST_CASE(pow_with_large_modulus, large_modulus_bits_samples)
+{
+    Integer mod = util::get_random(sample);
+    if (!mod.is_odd())
+        mod += constant::One;
+    const auto context = std::make_shared<ModContext>(mod);
+    const Integer base = util::get_random(sample + 1);
+    for (const Integer& e: {util::get_random(sample), Integer({0x10001}), constant::Zero}) {
+        ModInteger expected(constant::One, context);
+        const ModInteger b(base, context);
+        for (int i = e.most_significant_active_bit() - 1; i >= 0; i--) {
+            expected = expected.square();
+            if (e.get_bit_value(i))
+                expected *= b;
+        }
+        BOOST_TEST(context->pow(base, e) == expected.to_Integer());
+        BOOST_TEST(b.pow(e) == expected);
+    }
+}
+
+static binary_mod_op_sample_t small_base_pow_samples[] = {
+    {Integer({2}),
+     Integer({2, 0x8bb01460217f871c, 0xbe0ae8fa1ceac2cc}),
+     Integer({0x65}),
+     Integer({0x50})},
+    {Integer({2}),
+     Integer({2, 0x21eb4e0839f5c88e, 0x2d94628bb64ba4fd}),
+     Integer({0x64}),
+     Integer({0xc})},
+    {Integer({3}),
+     Integer({0x35fef5876ae5bc08, 0xc37f0ce876cf29a6}),
+     Integer({0x7fffffffffffffff, 0xffffffffffffffff}),
+     Integer({0x274b46f3aff0b281, 0xa320ad9e90323c13})},
+    {Integer({2}),
+     Integer({3, 0xd79e9be529b21b6c, 0x6444f53b24f1e3cd}),
+     Integer({0x8000000000000001, 6}),
+     Integer({0x1a033032bc96d031, 0x17db26d714452e78})},
+    {Integer({0x1d}),
+     Integer({0x3383ac783005a658, 0x9b3d2f10218feaa6}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0x3a515a13504b0a60, 0x90942252a14761b0})},
+    {Integer({2}),
+     Integer({1, 0x1850f2ab11cda0b8, 0x3d693da968311de3}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0xaeb2ed63ba921bf2, 0x8ac999f9fbf6b0d9})},
+    {Integer({7}),
+     Integer({3, 0xb24fa0d25086afab, 0xe5db963bfc17ebbe}),
+     Integer({5}),
+     Integer({4})},
+    {Integer({2}), Integer({0}), Integer({5}), Integer({1})},
+};
+
+BOOST_DATA_TEST_CASE(small_base_pow, small_base_pow_samples)
+{
+    const auto context = std::make_shared<ModContext>(sample.mod);
+    BOOST_TEST(context->pow(sample.lhs, sample.rhs) == sample.expected);
+    BOOST_TEST(sample.lhs.pow_mod(sample.rhs, sample.mod) == sample.expected);
+}
+
+static binary_op_sample_t inverse_samples[] = {
+    {Integer({0x13}), Integer({0x65}), Integer({0x10})},
+    {Integer({7}), Integer({0x64}), Integer({0x2b})},
+    {Integer({0x1212ebad4b78dc3d, 0x6baf71d7d8407b1a}),
+     Integer({0x7fffffffffffffff, 0xffffffffffffffff}),
+     Integer({0x40a525278fe2a39e, 0x9f6fd209df1098d1})},
+    {Integer({0x9ed2aa0cffd21f09, 0xec08693c7401f5cf}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0x57966cb176f7c30a, 0xc69311a985fc8f35})},
+};
+
+BOOST_DATA_TEST_CASE(inverse, inverse_samples)
+{
+    const auto context = std::make_shared<ModContext>(sample.rhs);
+    const ModInteger a(sample.lhs, context);
+    const ModInteger a_inv = a.inverse();
+    BOOST_TEST(a_inv.to_Integer() == sample.expected);
+    BOOST_TEST(a * a_inv == ModInteger(constant::One, context));
+}
+
+static binary_op_sample_t halve_samples[] = {
+    {Integer({0x20}), Integer({0x65}), Integer({0x10})},
+    {Integer({0x21}), Integer({0x65}), Integer({0x43})},
+    {Integer({0x7fffffffffffffff, 0xfffffffffffffffe}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0x3fffffffffffffff, 0xffffffffffffffff})},
+    {Integer({1}),
+     Integer({0xffffffffffffffff, 0xffffffffffffffc5}),
+     Integer({0x7fffffffffffffff, 0xffffffffffffffe3})},
+};
+
+BOOST_DATA_TEST_CASE(halve, halve_samples)
+{
+    const auto context = std::make_shared<ModContext>(sample.rhs);
+    BOOST_TEST(ModInteger(sample.lhs, context).halve().to_Integer() == sample.expected);
+}
+
+static binary_op_sample_t reduction_samples[] = {
+    {Integer({0x65}), Integer({0x65}), Integer({0})},
+    {Integer({0x1234}), Integer({0x65}), Integer({0xe})},
+    {Integer({0x1234}), Integer({0x64}), Integer({0x3c})},
+    {Integer({1, 0, 0}), Integer({0x7fffffffffffffff, 0xffffffffffffffff}), Integer({2})},
+    {Integer({0, 0x1234}), Integer({0x7fffffffffffffff, 0xffffffffffffffff}), Integer({0x1234})},
+};
+
+BOOST_DATA_TEST_CASE(reduction, reduction_samples)
+{
+    const auto context = std::make_shared<ModContext>(sample.rhs);
+    BOOST_TEST(ModInteger(sample.lhs, context).to_Integer() == sample.expected);
+}
+
+static const std::size_t reduce_modulus_bits_samples[] = {7, 64, 100, 128, 520, 1024};
+
+// Values longer than the modulus are compared with the long division.
+BOOST_DATA_TEST_CASE(reduce_wide_values, reduce_modulus_bits_samples)
+{
+    for (const bool odd: {true, false}) {
+        Integer mod = util::get_random(sample);
+        mod.set_bit_value(sample - 1, true);
+        mod.set_bit_value(0, odd);
+        const auto context = std::make_shared<ModContext>(mod);
+        const std::size_t k = context->get_num_blocks();
+        for (const std::size_t bits: {sample - 1, sample, 2 * sample + 5, 4 * sample}) {
+            const Integer n = util::get_random(bits);
+            const Integer expected = n % mod;
+            ModContext::block_t buf[k];
+            context->reduce(buf, n);
+            BOOST_TEST(Integer::from_blocks(buf, k) == expected);
+            BOOST_TEST(ModInteger(n, context).to_Integer() == expected);
+            BOOST_TEST(context->pow(n, constant::Three) == expected.pow_mod(constant::Three, mod));
+        }
+    }
+}
+
+static const std::size_t divide_modulus_bits_samples[] = {7, 64, 65, 128, 129, 520, 1024};
+
+// x = q * m + r is divided by the Barrett reduction of odd, even and power-of-two moduli.
+// 2^64 and 2^128 are b^(k-1), whose floor(b^2k / m) doesn't fit in k + 1 blocks. The
+// quotients of different lengths use different numbers of the blocks of mu.
+BOOST_DATA_TEST_CASE(divide, divide_modulus_bits_samples)
+{
+    Integer pow2(constant::Zero);
+    pow2.set_bit_value(sample - 1, true);
+    Integer odd = util::get_random(sample);
+    odd.set_bit_value(sample - 1, true);
+    odd.set_bit_value(0, true);
+    Integer even(odd);
+    even.set_bit_value(0, false);
+
+    for (const Integer& mod: {pow2, odd, even}) {
+        const auto context = std::make_shared<ModContext>(mod, ModContext::Reduction::Barrett);
+        BOOST_TEST(!context->is_montgomery());
+        const std::size_t k = context->get_num_blocks();
+        for (const std::size_t q_bits: {std::size_t(1), std::size_t(70), sample}) {
+            BOOST_TEST_CONTEXT("mod: " << mod << ", q_bits: " << q_bits) {
+                const Integer q = util::get_random(q_bits) % mod;
+                const Integer r = util::get_random(sample) % mod;
+                const Integer x = q * mod + r;
+                const std::size_t num_x = x.get_num_blocks();
+                ModContext::block_t q_buf[std::max(num_x, k) - k + 1], r_buf[k];
+                context->divide(q_buf, r_buf, x.ref_blocks(), num_x);
+                BOOST_TEST(Integer::from_blocks(q_buf, std::max(num_x, k) - k + 1) == q);
+                BOOST_TEST(Integer::from_blocks(r_buf, k) == r);
+                BOOST_TEST(context->pow(x, constant::Three) == r.pow_mod(constant::Three, mod));
+            }
+        }
+        const Integer r = util::get_random(sample) % mod;
+        const Integer q = util::get_random(sample) % mod;
+        BOOST_TEST((ModInteger(q, context) * ModInteger(mod + r, context)).to_Integer() ==
+                   (q * r) % mod);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(divide_with_invalid_arguments)
+{
+    const ModContext montgomery_context(Integer({101}));
+    const ModContext barrett_context(Integer({101}), ModContext::Reduction::Barrett);
+    ModContext::block_t q[2], r[1];
+    const ModContext::block_t x[3] = {0x1234, 0, 0};
+    BOOST_CHECK_THROW(montgomery_context.divide(q, r, x, 2), std::invalid_argument);
+    BOOST_CHECK_THROW(barrett_context.divide(q, r, x, 3), std::invalid_argument);
+    barrett_context.divide(q, r, x, 2);
+    BOOST_TEST(q[0] == 0x1234 / 101);
+    BOOST_TEST(r[0] == 0x1234 % 101);
+}
+
+BOOST_AUTO_TEST_CASE(different_contexts)
+{
+    const ModInteger a(constant::Two, std::make_shared<ModContext>(Integer({7})));
+    const ModInteger b(constant::Two, std::make_shared<ModContext>(Integer({7})));
+    const ModInteger c(constant::Two, std::make_shared<ModContext>(Integer({9})));
+    BOOST_TEST(a == b);
+    BOOST_CHECK_THROW(a + c, std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(different_reductions)
+{
+    const Integer m({1000003});
+    const auto montgomery_context = std::make_shared<ModContext>(m);
+    const auto barrett_context = std::make_shared<ModContext>(m, ModContext::Reduction::Barrett);
+    const ModInteger a(Integer({5}), montgomery_context);
+    const ModInteger b(Integer({5}), barrett_context);
+    BOOST_CHECK_THROW(a * b, std::invalid_argument);
+    BOOST_CHECK_THROW(a + b, std::invalid_argument);
+    BOOST_CHECK_THROW(a == b, std::invalid_argument);
+    BOOST_TEST(a.to_Integer() == b.to_Integer());
+}
+
+BOOST_AUTO_TEST_CASE(zero_modulus)
+{
+    BOOST_CHECK_THROW(ModContext(constant::Zero), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
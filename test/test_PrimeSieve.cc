@@ -0,0 +1,111 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <vector>
+#include "PrimeSieve.h"
+
+using namespace grill;
+using block_t = PrimeSieve::block_t;
+
+static bool is_prime(const block_t n) {
+    if (n < 2)
+        return false;
+    for (block_t i = 2; i <= n / i; i++) {
+        if (n % i == 0)
+            return false;
+    }
+    return true;
+}
+
+static std::vector<block_t> get_expected_primes(const block_t from, const block_t to) {
+    std::vector<block_t> primes;
+    for (block_t n = from; n < to; n++) {
+        if (is_prime(n))
+            primes.emplace_back(n);
+    }
+    return primes;
+}
+
+BOOST_AUTO_TEST_SUITE(test_suite_PrimeSieve)
+
+static struct range_sample_t {
+    block_t from;
+    block_t to;
+
+    friend std::ostream& operator<<(std::ostream& os, const range_sample_t& s) {
+        os << "from: " << s.from << ", to: " << s.to;
+        return os;
+    }
+} range_samples[] = {
+    {0, 0},
+    {0, 2},
+    {0, 3},
+    {0, 100},
+    {2, 3},
+    {3, 4},
+    {4, 7},
+    {7, 8},
+    {8, 11},
+    {90, 97},
+    {90, 98},
+    {200, 230},                   // Over the wheel period
+    {0, 2 * PrimeSieve::SegmentSize + 1},
+    {2 * PrimeSieve::SegmentSize - 100, 2 * PrimeSieve::SegmentSize + 100}, // Segment boundary
+    {1'000'000'000, 1'000'001'000},
+    {0x100'0000'0000, 0x100'0000'1000},  // Over 2^40
+    {0x4'0000'0000'0000, 0x4'0000'0000'0040}, // Over SmallPrimeTableLimit^2
+};
+
+BOOST_DATA_TEST_CASE(get_primes, range_samples)
+{
+    BOOST_TEST(PrimeSieve::get_primes(sample.from, sample.to) ==
+               get_expected_primes(sample.from, sample.to), boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(iterate_twice)
+{
+    PrimeSieve sieve(10, 30);
+    const std::vector<block_t> expected = {11, 13, 17, 19, 23, 29};
+    for (int i = 0; i < 2; i++) {
+        std::vector<block_t> primes;
+        for (const block_t p: sieve)
+            primes.emplace_back(p);
+        BOOST_TEST(primes == expected, boost::test_tools::per_element());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(next)
+{
+    PrimeSieve sieve(0, 6);
+    BOOST_TEST(*sieve.next() == 2);
+    BOOST_TEST(*sieve.next() == 3);
+    BOOST_TEST(*sieve.next() == 5);
+    BOOST_TEST(!sieve.next());
+}
+
+BOOST_AUTO_TEST_CASE(get_small_primes)
+{
+    // The limit is over the initial table, so the table is extended.
+    constexpr block_t Limit = 1 << 20;
+    const auto primes = PrimeSieve::get_small_primes(Limit);
+    BOOST_TEST(primes.back() >= Limit - 100);
+    std::size_t num = 0;
+    for (const block_t p: primes) {
+        if (p >= Limit)
+            break;
+        num++;
+    }
+    BOOST_TEST(num == 82'025); // pi(2^20)
+    BOOST_TEST(PrimeSieve::get_small_primes(100).data() == primes.data());
+}
+
+BOOST_AUTO_TEST_CASE(get_small_primes_up_to_table_limit)
+{
+    const auto first = PrimeSieve::get_small_primes(100);
+    const auto primes = PrimeSieve::get_small_primes(PrimeSieve::SmallPrimeTableLimit);
+    BOOST_TEST(primes.data() == first.data()); // Extended in place
+    BOOST_TEST(primes.size() == 1'077'871); // pi(2^24)
+    BOOST_CHECK_THROW(PrimeSieve::get_small_primes(PrimeSieve::SmallPrimeTableLimit + 1),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,68 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include "ThreadPool.h"
+
+using namespace grill;
+
+BOOST_AUTO_TEST_SUITE(test_suite_ThreadPool)
+
+static const std::size_t num_threads_samples[] = {1, 2, 4};
+
+BOOST_DATA_TEST_CASE(num_threads, num_threads_samples)
+{
+    ThreadPool pool(sample);
+    BOOST_TEST(pool.get_num_threads() == sample);
+}
+
+BOOST_AUTO_TEST_CASE(default_num_threads)
+{
+    ThreadPool pool;
+    BOOST_TEST(pool.get_num_threads() == ThreadPool::resolve_num_threads(0));
+    BOOST_TEST(pool.get_num_threads() > 0);
+}
+
+BOOST_DATA_TEST_CASE(submit, num_threads_samples)
+{
+    ThreadPool pool(sample);
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 10; i++)
+        futures.emplace_back(pool.submit([i] { return i * i; }));
+    for (int i = 0; i < 10; i++)
+        BOOST_TEST(futures[i].get() == i * i);
+}
+
+BOOST_AUTO_TEST_CASE(submit_with_exception)
+{
+    ThreadPool pool(1);
+    auto future = pool.submit([]() -> int { throw std::runtime_error("error"); });
+    BOOST_CHECK_THROW(future.get(), std::runtime_error);
+}
+
+BOOST_DATA_TEST_CASE(run, num_threads_samples)
+{
+    constexpr std::size_t N = 1000;
+    std::vector<std::atomic<int>> counts(N);
+    ThreadPool pool(sample);
+    pool.run(N, [&](const std::size_t i) {
+        counts[i]++;
+    });
+    for (const auto& count: counts)
+        BOOST_TEST(count == 1);
+}
+
+BOOST_AUTO_TEST_CASE(run_with_exception)
+{
+    std::atomic<std::size_t> num_calls(0);
+    ThreadPool pool(2);
+    BOOST_CHECK_THROW(pool.run(10, [&](const std::size_t i) {
+        num_calls++;
+        if (i == 3)
+            throw std::runtime_error("error");
+    }), std::runtime_error);
+    BOOST_TEST(num_calls == 10);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
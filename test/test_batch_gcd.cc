@@ -0,0 +1,160 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <filesystem>
+#include <vector>
+#include "batch_gcd.h"
+#include "constant.h"
+#include "util.h"
+
+using namespace grill;
+
+BOOST_AUTO_TEST_SUITE(test_suite_batch_gcd)
+
+static const std::vector<Integer> Moduli = {
+    Integer({3 * 5}),
+    Integer({7 * 11}),
+    Integer({5 * 13}),
+    Integer({17 * 19}),
+    Integer({23 * 29}),
+    Integer({11 * 31}),
+    Integer({37 * 37}),
+    Integer({3 * 41}),
+    Integer({1}),
+};
+
+static std::vector<Integer> calc_expected_gcds(const std::vector<Integer>& moduli) {
+    std::vector<Integer> gcds;
+    for (std::size_t i = 0; i < moduli.size(); i++) {
+        Integer product(constant::One);
+        for (std::size_t j = 0; j < moduli.size(); j++) {
+            if (j != i)
+                product *= moduli[j];
+        }
+        gcds.emplace_back(util::gcd(moduli[i], product));
+    }
+    return gcds;
+}
+
+BOOST_AUTO_TEST_CASE(build_product_tree)
+{
+    const batch_gcd::ProductTree tree = batch_gcd::build_product_tree(Moduli, 2);
+    BOOST_TEST(tree.size() == 5);
+    BOOST_TEST(tree[1].size() == 5);
+    BOOST_TEST(tree[1][4] == Integer({1}));
+    Integer product(constant::One);
+    for (const Integer& n: Moduli)
+        product *= n;
+    BOOST_TEST(tree.back().size() == 1);
+    BOOST_TEST(tree.back().front() == product);
+}
+
+BOOST_AUTO_TEST_CASE(build_product_tree_with_zero)
+{
+    BOOST_CHECK_THROW(batch_gcd::build_product_tree({Integer({3}), constant::Zero}),
+                      std::invalid_argument);
+}
+
+static struct remainder_sample_t {
+    std::size_t quotient_bits;
+    std::size_t leaf_bits;
+
+    friend std::ostream& operator<<(std::ostream& os, const remainder_sample_t& s) {
+        os << "quotient_bits: " << s.quotient_bits << ", leaf_bits: " << s.leaf_bits;
+        return os;
+    }
+} remainder_samples[] = {
+    {1, 3},
+    {64, 64},
+    {100, 1000},
+    {1000, 100},
+    {10'000, 3000},
+    {3000, 10'000},
+    {40'000, 2048},
+};
+
+// x = q * leaf^2 + r is reduced by the tree with only the leaf.
+BOOST_DATA_TEST_CASE(calc_remainders, remainder_samples)
+{
+    Integer leaf = util::get_random(sample.leaf_bits);
+    leaf.set_bit_value(sample.leaf_bits - 1, true);
+    const Integer square = leaf * leaf;
+    const Integer q = util::get_random(sample.quotient_bits);
+    const Integer r = square - util::get_random(sample.leaf_bits) - constant::One;
+    const Integer x = q * square + r;
+
+    const batch_gcd::ProductTree tree = batch_gcd::build_product_tree({leaf});
+    const std::vector<Integer> remainders = batch_gcd::calc_remainders(x, tree);
+    BOOST_TEST(remainders.size() == 1);
+    BOOST_TEST(remainders[0] == r);
+}
+
+BOOST_AUTO_TEST_CASE(calc_remainders_of_leaves)
+{
+    const batch_gcd::ProductTree tree = batch_gcd::build_product_tree(Moduli, 3);
+    const Integer x = Integer({0x1234'5678'9abc'def0, 0x0fed'cba9'8765'4321});
+    const std::vector<Integer> remainders = batch_gcd::calc_remainders(x, tree, 3);
+    BOOST_TEST(remainders.size() == Moduli.size());
+    for (std::size_t i = 0; i < Moduli.size(); i++)
+        BOOST_TEST(remainders[i] == x % (Moduli[i] * Moduli[i]));
+}
+
+static struct options_sample_t {
+    std::size_t num_threads;
+    std::size_t group_size;
+    bool streaming;
+
+    friend std::ostream& operator<<(std::ostream& os, const options_sample_t& s) {
+        os << "num_threads: " << s.num_threads << ", group_size: " << s.group_size
+           << ", streaming: " << s.streaming;
+        return os;
+    }
+} options_samples[] = {
+    {1, batch_gcd::DefaultGroupSize, false},
+    {1, 1, false},
+    {1, 2, false},
+    {4, 4, false},
+    {0, 3, false},
+    {1, batch_gcd::DefaultGroupSize, true},
+    {2, 2, true},
+};
+
+static batch_gcd::Options create_options(const options_sample_t& sample) {
+    batch_gcd::Options options;
+    options.num_threads = sample.num_threads;
+    options.group_size = sample.group_size;
+    if (sample.streaming)
+        options.work_dir = std::filesystem::temp_directory_path();
+    return options;
+}
+
+BOOST_DATA_TEST_CASE(calc, options_samples)
+{
+    const std::vector<Integer> gcds = batch_gcd::calc(Moduli, create_options(sample));
+    BOOST_TEST(gcds == calc_expected_gcds(Moduli), boost::test_tools::per_element());
+}
+
+BOOST_DATA_TEST_CASE(calc_with_shared_primes, options_samples)
+{
+    // The moduli of 1024 bits. The 1st and 4th share a prime.
+    std::vector<Integer> primes;
+    for (int i = 0; i < 7; i++)
+        primes.emplace_back(util::get_random_prime(512));
+    const std::vector<Integer> moduli = {
+        primes[0] * primes[1],
+        primes[2] * primes[3],
+        primes[4] * primes[5],
+        primes[6] * primes[0],
+    };
+    const std::vector<Integer> expected = {
+        primes[0], constant::One, constant::One, primes[0],
+    };
+    const std::vector<Integer> gcds = batch_gcd::calc(moduli, create_options(sample));
+    BOOST_TEST(gcds == expected, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(calc_without_moduli)
+{
+    BOOST_TEST(batch_gcd::calc({}).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,159 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <stdexcept>
+#include <vector>
+#include "Integer.h"
+#include "constant.h"
+#include "util.h"
+#include "ModInteger.h"
+#include "batch_pow_mod.h"
+
+using namespace grill;
+
+BOOST_AUTO_TEST_SUITE(test_suite_batch_pow_mod)
+
+static std::vector<batch_pow_mod::Backend> get_backends() {
+    std::vector<batch_pow_mod::Backend> backends = {batch_pow_mod::Backend::Scalar};
+    if (batch_pow_mod::get_backend() != batch_pow_mod::Backend::Scalar)
+        backends.emplace_back(batch_pow_mod::get_backend());
+    return backends;
+}
+
+static Integer get_random_odd(const std::size_t bit_length) {
+    Integer n = util::get_random(bit_length);
+    if (!n.is_odd())
+        n += constant::One;
+    return n;
+}
+
+struct pow_sample_t {
+    std::size_t modulus_bits;
+    std::size_t exponent_bits;
+    std::size_t count;
+
+    friend std::ostream& operator<<(std::ostream& os, const pow_sample_t& s) {
+        os << "modulus_bits: " << s.modulus_bits << ", exponent_bits: " << s.exponent_bits
+           << ", count: " << s.count;
+        return os;
+    }
+};
+
+static const pow_sample_t pow_samples[] = {
+    {64, 64, 8},
+    {100, 20, 3},
+    {519, 519, 9},
+    {520, 100, 16},
+    {1024, 1024, 8},
+    {2048, 17, 11},
+    {2048, 2048, 8},
+    {4096, 300, 5},
+};
+
+BOOST_DATA_TEST_CASE(calc_with_different_moduli, pow_samples)
+{
+    std::vector<Integer> bases, exponents, moduli;
+    for (std::size_t i = 0; i < sample.count; i++) {
+        moduli.emplace_back(get_random_odd(sample.modulus_bits));
+        bases.emplace_back(util::get_random(sample.modulus_bits + 10));
+        exponents.emplace_back(util::get_random(sample.exponent_bits - i % 3));
+    }
+    for (const auto backend: get_backends()) {
+        const std::vector<Integer> results =
+          batch_pow_mod::calc(bases, exponents, moduli, backend);
+        BOOST_REQUIRE(results.size() == sample.count);
+        for (std::size_t i = 0; i < sample.count; i++)
+            BOOST_TEST(results[i] == bases[i].pow_mod(exponents[i], moduli[i]));
+    }
+}
+
+BOOST_DATA_TEST_CASE(calc_with_one_modulus, pow_samples)
+{
+    const std::vector<Integer> exponents = {util::get_random(sample.exponent_bits)};
+    const std::vector<Integer> moduli = {get_random_odd(sample.modulus_bits)};
+    std::vector<Integer> bases;
+    for (std::size_t i = 0; i < sample.count; i++)
+        bases.emplace_back(util::get_random(sample.modulus_bits - 1));
+    for (const auto backend: get_backends()) {
+        const std::vector<Integer> results =
+          batch_pow_mod::calc(bases, exponents, moduli, backend);
+        BOOST_REQUIRE(results.size() == sample.count);
+        for (std::size_t i = 0; i < sample.count; i++)
+            BOOST_TEST(results[i] == bases[i].pow_mod(exponents[0], moduli[0]));
+    }
+}
+
+BOOST_DATA_TEST_CASE(calc_with_context, pow_samples)
+{
+    const std::vector<Integer> exponents = {util::get_random(sample.exponent_bits)};
+    const ModContext context(get_random_odd(sample.modulus_bits));
+    std::vector<Integer> bases;
+    for (std::size_t i = 0; i < sample.count; i++)
+        bases.emplace_back(util::get_random(sample.modulus_bits + 10));
+    for (const auto backend: get_backends()) {
+        const std::vector<Integer> results =
+          batch_pow_mod::calc(bases, exponents, context, backend);
+        BOOST_REQUIRE(results.size() == sample.count);
+        for (std::size_t i = 0; i < sample.count; i++)
+            BOOST_TEST(results[i] == bases[i].pow_mod(exponents[0], context.get_modulus()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(calc_with_mixed_sizes)
+{
+    std::vector<Integer> bases, exponents, moduli;
+    for (const std::size_t bits: {1024, 64, 2048, 1024, 512, 64, 2048, 1024, 1024, 512}) {
+        moduli.emplace_back(get_random_odd(bits));
+        bases.emplace_back(util::get_random(bits - 1));
+        exponents.emplace_back(util::get_random(bits));
+    }
+    for (const auto backend: get_backends()) {
+        const std::vector<Integer> results =
+          batch_pow_mod::calc(bases, exponents, moduli, backend);
+        for (std::size_t i = 0; i < bases.size(); i++)
+            BOOST_TEST(results[i] == bases[i].pow_mod(exponents[i], moduli[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(calc_with_special_values)
+{
+    const Integer modulus = get_random_odd(1024);
+    const std::vector<Integer> bases = {
+        constant::Zero, constant::One, constant::Two, modulus - constant::One, modulus,
+    };
+    const std::vector<Integer> exponents = {
+        constant::Zero, constant::One, constant::Zero, constant::Two, constant::Three,
+    };
+    const std::vector<Integer> moduli = {modulus};
+    const std::vector<Integer> expected = {
+        constant::One, constant::One, constant::One, constant::One, constant::Zero,
+    };
+    for (const auto backend: get_backends())
+        BOOST_TEST(batch_pow_mod::calc(bases, exponents, moduli, backend) == expected,
+                   boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(calc_with_no_bases)
+{
+    const std::vector<Integer> bases;
+    const std::vector<Integer> values = {Integer({77})};
+    BOOST_TEST(batch_pow_mod::calc(bases, values, values).empty());
+}
+
+BOOST_AUTO_TEST_CASE(calc_with_invalid_arguments)
+{
+    const std::vector<Integer> bases = {Integer({2}), Integer({3})};
+    const std::vector<Integer> exponents = {Integer({5}), Integer({7}), Integer({11})};
+    const std::vector<Integer> moduli = {Integer({77})};
+    const std::vector<Integer> even_moduli = {Integer({78})};
+    const std::vector<Integer> one_moduli = {constant::One};
+    BOOST_CHECK_THROW(batch_pow_mod::calc(bases, exponents, moduli), std::invalid_argument);
+    BOOST_CHECK_THROW(batch_pow_mod::calc(bases, moduli, exponents), std::invalid_argument);
+    BOOST_CHECK_THROW(batch_pow_mod::calc(bases, moduli, even_moduli), std::invalid_argument);
+    BOOST_CHECK_THROW(batch_pow_mod::calc(bases, moduli, one_moduli), std::invalid_argument);
+    const ModContext context(Integer({77}));
+    const ModContext even_context(Integer({78}));
+    BOOST_CHECK_THROW(batch_pow_mod::calc(bases, exponents, context), std::invalid_argument);
+    BOOST_CHECK_THROW(batch_pow_mod::calc(bases, moduli, even_context), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,87 @@
+#include <boost/test/unit_test.hpp>
+#include <boost/test/data/test_case.hpp>
+#include <vector>
+#include "factorization.h"
+#include "constant.h"
+
+using namespace grill;
+
+BOOST_AUTO_TEST_SUITE(test_suite_factorization)
+
+static const Integer M31 = Integer({0x7fff'ffff});
+static const Integer M61 = Integer({0x1fff'ffff'ffff'ffff});
+
+struct factorize_sample_t {
+    const Integer& n;
+    const std::vector<Integer> expected;
+
+    friend std::ostream& operator<<(std::ostream& os, const factorize_sample_t& s) {
+        os << "n: " << s.n;
+        return os;
+    }
+};
+
+static const factorize_sample_t factorize_samples[] = {
+    {Integer({1}),  {}},
+    {Integer({2}),  {Integer({2})}},
+    {Integer({12}), {Integer({2}), Integer({2}), Integer({3})}},
+    {Integer({16'381}), {Integer({16'381})}},
+    {Integer({16'411 * 16'417}), {Integer({16'411}), Integer({16'417})}},
+    {M61, {M61}},
+    {Integer({1'000'003ul * 1'000'033ul}), {Integer({1'000'003}), Integer({1'000'033})}},
+    {M31 * M61, {M31, M61}},
+    {Integer({5}) * M31 * M31, {Integer({5}), M31, M31}},
+    // 2^64 + 1
+    {Integer({1, 1}), {Integer({274'177}), Integer({67'280'421'310'721})}},
+};
+
+BOOST_DATA_TEST_CASE(factorize, factorize_samples)
+{
+    BOOST_TEST(factorization::factorize(sample.n) == sample.expected,
+               boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(factorize_zero)
+{
+    BOOST_CHECK_THROW(factorization::factorize(constant::Zero), std::invalid_argument);
+}
+
+static const std::size_t num_threads_samples[] = {1, 2, 4};
+
+BOOST_DATA_TEST_CASE(pollard_brent, num_threads_samples)
+{
+    factorization::Options options;
+    options.num_threads = sample;
+    for (const Integer& n: {Integer({1'000'003ul * 1'000'033ul}), M31 * M61}) {
+        const std::optional<Integer> d = factorization::pollard_brent(n, options);
+        BOOST_REQUIRE(d.has_value());
+        BOOST_TEST(*d != constant::One);
+        BOOST_TEST(*d != n);
+        BOOST_TEST((n / *d) * *d == n);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pollard_brent_with_limits)
+{
+    factorization::Options options;
+    options.num_threads = 1;
+    options.max_iterations = 10;
+    options.max_seeds = 1;
+    BOOST_TEST(!factorization::pollard_brent(M31 * M61, options).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(pollard_brent_with_even_number)
+{
+    BOOST_CHECK_THROW(factorization::pollard_brent(Integer({10})), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(pollard_brent_with_prime)
+{
+    BOOST_CHECK_THROW(factorization::pollard_brent(Integer({2'147'483'647})),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(factorization::pollard_brent(
+                        Integer({0x7fff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff})),
+                      std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
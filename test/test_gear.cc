@@ -161,4 +161,251 @@ BOOST_DATA_TEST_CASE(karatsuba, karatsuba_samples)
     BOOST_TEST(out == sample.expected);
 }
 
+struct remainder_sample_t {
+    const std::vector<uint64_t> blocks;
+    const uint64_t d;
+    const uint64_t expected;
+    friend std::ostream& operator<<(std::ostream& os, const remainder_sample_t& s) {
+        os << std::hex << "blocks: " << gear::to_string(s.blocks) <<
+            ", d: " << s.d << ", expected: " << s.expected << std::endl;
+        return os;
+    }
+};
+
+static remainder_sample_t remainder_samples[] {
+    {{7}, 3, 1},
+    {{0xffff'ffff'ffff'ffff}, 0xffff'ffff'ffff'ffff, 0},
+    {{0, 1}, 3, 1},
+    {{0, 1}, 0xffff'ffff'ffff'ffff, 1},
+    {{0x1234'5678'9abc'def0, 0x1234'5678'9abc'def0}, 1'000'000'007, 0x958'1cdd},
+};
+
+BOOST_DATA_TEST_CASE(remainder, remainder_samples)
+{
+    BOOST_TEST(gear::remainder(sample.blocks.data(), sample.blocks.size(), sample.d) ==
+               sample.expected);
+}
+
+BOOST_DATA_TEST_CASE(small_divisors, remainder_samples)
+{
+    // The number of divisors isn't a multiple of the lanes.
+    const std::vector<uint64_t> divisors = {
+        2, 3, 7, 11, 255, 256, 257, 1009, 65'521, 65'536, 1'000'000'007, 0xffff'ffff,
+        0x8000'0000, 3,
+    };
+    const gear::SmallDivisors small_divisors(divisors);
+    BOOST_TEST(small_divisors.size() == divisors.size());
+
+    uint64_t out[divisors.size()];
+    small_divisors.remainders(out, sample.blocks.data(), sample.blocks.size());
+    for (std::size_t i = 0; i < divisors.size(); i++) {
+        BOOST_TEST(out[i] == gear::remainder(sample.blocks.data(), sample.blocks.size(),
+                                             divisors[i]));
+    }
+}
+
+struct mul_mod_sample_t {
+    const uint64_t a;
+    const uint64_t b;
+    const uint64_t m;
+    const uint64_t expected;
+    friend std::ostream& operator<<(std::ostream& os, const mul_mod_sample_t& s) {
+        os << std::hex << "a: " << s.a << ", b: " << s.b <<
+            ", m: " << s.m << ", expected: " << s.expected << std::endl;
+        return os;
+    }
+};
+
+static mul_mod_sample_t mul_mod_samples[] {
+    {3, 5, 7, 1},
+    {0xffff'ffff'ffff'ffff, 0xffff'ffff'ffff'fffe, 0xffff'ffff'ffff'ffc5, 0xcea},
+};
+
+BOOST_DATA_TEST_CASE(mul_mod, mul_mod_samples)
+{
+    BOOST_TEST(gear::mul_mod(sample.a, sample.b, sample.m) == sample.expected);
+}
+
+struct pow_mod_sample_t {
+    const uint64_t base;
+    const std::vector<uint64_t> e;
+    const uint64_t m;
+    const uint64_t expected;
+    friend std::ostream& operator<<(std::ostream& os, const pow_mod_sample_t& s) {
+        os << std::hex << "base: " << s.base << ", e: " << gear::to_string(s.e) <<
+            ", m: " << s.m << ", expected: " << s.expected << std::endl;
+        return os;
+    }
+};
+
+static pow_mod_sample_t pow_mod_samples[] {
+    {3, {0x1234}, 1'000'000'007, 0x253'b641},
+    {2, {1000}, 1'000'000'007, 0x2908'812a},
+    {5, {0}, 7, 1},
+    {5, {3}, 1, 0},
+    {0x1234'5678'9abc'def0, {0xfedc'ba98'7654'3210}, 0xffff'ffff'ffff'ffc5, 0xf693'ca11'b688'a5f0},
+    {7, {5, 1}, 0xffff'ffff'ffff'ffc5, 0x0d25'db91'9e77'cb0a},
+    {7, {5, 1, 0}, 0xffff'ffff'ffff'ffc5, 0x0d25'db91'9e77'cb0a},  // A leading zero block
+    {7, {5, 1}, 0xffff'ffff'ffff'fffe, 0xde7a'35cd'02e2'91f3},     // Even modulus
+    {5, {100}, 0x8000'0000'0000'0000, 0x4aab'2430'8a82'e8f1},
+};
+
+BOOST_DATA_TEST_CASE(pow_mod, pow_mod_samples)
+{
+    BOOST_TEST(gear::pow_mod(sample.base, sample.e.data(), sample.e.size(), sample.m) ==
+               sample.expected);
+}
+
+BOOST_AUTO_TEST_CASE(montgomery64)
+{
+    const uint64_t n = 0xffff'ffff'ffff'ffc5;
+    const gear::Montgomery64 mont(n);
+    const uint64_t a = mont.to_montgomery(0xffff'ffff'ffff'ffff);
+    const uint64_t b = mont.to_montgomery(0xffff'ffff'ffff'fffe);
+    BOOST_TEST(mont.from_montgomery(mont.one()) == 1);
+    BOOST_TEST(mont.from_montgomery(mont.mul(a, b)) == 0xcea);
+}
+
+static const std::size_t montgomery_sqr_num_samples[] = {1, 2, 3, 8, 33};
+
+BOOST_DATA_TEST_CASE(montgomery_sqr, montgomery_sqr_num_samples)
+{
+    // n = 2^(64*num) - 59 or with a cleared top bit for the lazy reduction, and a < n.
+    for (const bool lazy: {false, true}) {
+        std::vector<uint64_t> n(sample, 0xffff'ffff'ffff'ffff);
+        n[0] = 0xffff'ffff'ffff'ffc5;
+        if (lazy)
+            n[sample - 1] >>= 2;
+        std::vector<uint64_t> a(n);
+        a[0] -= 2;
+        for (std::size_t i = 1; i < sample; i += 2)
+            a[i] = 0x0123'4567'89ab'cdef * i;
+        const uint64_t n0inv = gear::montgomery_n0inv(n[0]);
+
+        std::vector<uint64_t> expected(sample), actual(sample);
+        if (lazy) {
+            gear::montgomery_mul_lazy(expected.data(), a.data(), a.data(), n.data(), sample, n0inv);
+            gear::montgomery_sqr_lazy(actual.data(), a.data(), n.data(), sample, n0inv);
+        } else {
+            gear::montgomery_mul(expected.data(), a.data(), a.data(), n.data(), sample, n0inv);
+            gear::montgomery_sqr(actual.data(), a.data(), n.data(), sample, n0inv);
+        }
+        BOOST_TEST(actual == expected, boost::test_tools::per_element());
+    }
+}
+
+static const std::size_t limbs52_num_samples[] = {1, 2, 3, 5, 13, 32};
+
+BOOST_DATA_TEST_CASE(limbs52, limbs52_num_samples)
+{
+    std::vector<uint64_t> blocks(sample);
+    for (std::size_t i = 0; i < sample; i++)
+        blocks[i] = 0xfedc'ba98'7654'3210 ^ (0x0123'4567'89ab'cdef * i);
+    const std::size_t num_limbs = (sample * 64 + gear::Limb52Bits - 1) / gear::Limb52Bits;
+    std::vector<uint64_t> limbs(num_limbs), actual(sample);
+    gear::to_limbs52(limbs.data(), num_limbs, blocks.data(), sample);
+    for (const uint64_t limb: limbs)
+        BOOST_TEST(limb >> gear::Limb52Bits == 0);
+    gear::from_limbs52(actual.data(), sample, limbs.data(), num_limbs);
+    BOOST_TEST(actual == blocks, boost::test_tools::per_element());
+}
+
+BOOST_DATA_TEST_CASE(limbs52_with_stride, limbs52_num_samples)
+{
+    constexpr std::size_t stride = 3;
+    std::vector<uint64_t> blocks(sample);
+    for (std::size_t i = 0; i < sample; i++)
+        blocks[i] = 0x0123'4567'89ab'cdef ^ (0xfedc'ba98'7654'3210 * i);
+    const std::size_t num_limbs = (sample * 64 + gear::Limb52Bits - 1) / gear::Limb52Bits;
+    std::vector<uint64_t> limbs(num_limbs), interleaved(num_limbs * stride, 0);
+    gear::to_limbs52(limbs.data(), num_limbs, blocks.data(), sample);
+    gear::to_limbs52(&interleaved[1], num_limbs, blocks.data(), sample, stride);
+    for (std::size_t j = 0; j < num_limbs; j++) {
+        BOOST_TEST(interleaved[j * stride] == 0);
+        BOOST_TEST(interleaved[j * stride + 1] == limbs[j]);
+        BOOST_TEST(interleaved[j * stride + 2] == 0);
+    }
+    std::vector<uint64_t> actual(sample);
+    gear::from_limbs52(actual.data(), sample, &interleaved[1], num_limbs, stride);
+    BOOST_TEST(actual == blocks, boost::test_tools::per_element());
+}
+
+struct window_sample_t {
+    const int pos;
+    const int width;
+    const unsigned int expected;
+    friend std::ostream& operator<<(std::ostream& os, const window_sample_t& s) {
+        os << "pos: " << s.pos << ", width: " << s.width << ", expected: " << s.expected;
+        return os;
+    }
+};
+
+// e = 0x8000'0000'0000'0005'f000'0000'0000'0003
+static const window_sample_t window_samples[] {
+    {0, 1, 1},
+    {0, 4, 3},
+    {60, 4, 0xf},
+    {62, 4, 0x7},
+    {64, 5, 5},
+    {124, 4, 8},
+    {127, 5, 1},
+    {128, 5, 0},
+};
+
+BOOST_DATA_TEST_CASE(get_window, window_samples)
+{
+    const uint64_t e[] = {0xf000'0000'0000'0003, 0x8000'0000'0000'0005};
+    BOOST_TEST(gear::get_window(e, 2, sample.pos, sample.width) == sample.expected);
+}
+
+BOOST_AUTO_TEST_CASE(choose_window_bits)
+{
+    int prev = gear::choose_window_bits(0);
+    BOOST_TEST(prev >= 1);
+    for (const int bits: {1, 17, 64, 512, 1024, 2048, 4096, 16384}) {
+        const int w = gear::choose_window_bits(bits);
+        BOOST_TEST(w >= prev);
+        BOOST_TEST(w < 32);
+        prev = w;
+    }
+}
+
+// R = 2^(52*num) is the same as R of montgomery_mul() with num * 52 / 64 blocks.
+static const std::size_t montgomery_mul52_num_samples[] = {16, 32, 128};
+
+BOOST_DATA_TEST_CASE(montgomery_mul52, montgomery_mul52_num_samples)
+{
+    if (!gear::is_ifma_supported())
+        return;
+
+    // n = 2^(64*num_blocks - 2) - 59, and a, b < n.
+    const std::size_t num_blocks = sample * gear::Limb52Bits / 64;
+    std::vector<uint64_t> n(num_blocks, 0xffff'ffff'ffff'ffff);
+    n[0] = 0xffff'ffff'ffff'ffc5;
+    n[num_blocks - 1] >>= 2;
+    std::vector<uint64_t> a(n), b(n);
+    a[0] -= 2;
+    for (std::size_t i = 1; i < num_blocks; i += 2) {
+        a[i] = 0x0123'4567'89ab'cdef * i;
+        b[i - 1] = 0xfedc'ba98'7654'3210 ^ i;
+    }
+    const uint64_t n0inv = gear::montgomery_n0inv(n[0]);
+    std::vector<uint64_t> expected(num_blocks);
+    gear::montgomery_mul(expected.data(), a.data(), b.data(), n.data(), num_blocks, n0inv);
+
+    const std::size_t size = gear::get_limb52_buffer_size(sample);
+    std::vector<uint64_t> n52(size), a52(size), b52(size), out52(size);
+    gear::to_limbs52(n52.data(), size, n.data(), num_blocks);
+    gear::to_limbs52(a52.data(), size, a.data(), num_blocks);
+    gear::to_limbs52(b52.data(), size, b.data(), num_blocks);
+    const uint64_t n0inv52 = n0inv & ((1ULL << gear::Limb52Bits) - 1);
+    gear::montgomery_mul52(out52.data(), a52.data(), b52.data(), n52.data(), sample, n0inv52);
+
+    std::vector<uint64_t> actual(num_blocks);
+    gear::from_limbs52(actual.data(), num_blocks, out52.data(), sample);
+    if (gear::compare(actual.data(), n.data(), num_blocks) >= 0)
+        gear::sub(actual.data(), num_blocks, n.data(), num_blocks);
+    BOOST_TEST(actual == expected, boost::test_tools::per_element());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
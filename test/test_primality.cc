@@ -1,7 +1,11 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
 #include <iostream>
+#include <algorithm>
+#include <optional>
+#include <vector>
 #include "primality.h"
+#include "constant.h"
 #include "util.h"
 
 using namespace grill;
@@ -53,6 +57,16 @@ static struct sample_t {
     {Integer({2'147'483'647}), true, true}, // M31 (2^31-1})
     {Integer({9'999'999'967}), true, true}, // Over 2^32
     {Integer({0x7fff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff}), true, true}, // M127 (2^127-1)
+    {Integer({561}), false},              // Carmichael number (3*11*17)
+    {Integer({2047}), false},             // Strong pseudoprime to base 2 (23*89)
+    {Integer({25'326'001}), false},       // Strong pseudoprime to bases 2, 3 and 5
+    {Integer({1'194'649}), false},        // 1093^2, strong pseudoprime to base 2
+    {Integer({5459}), false},             // Strong Lucas pseudoprime (53*103)
+    {Integer({5777}), false},             // Strong Lucas pseudoprime (53*109)
+    {Integer({0x4c00000393, 0x1}), false, true}, // 4294967311*4294967357
+    {Integer({0x1ff, 0xffff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff,
+              0xffff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff,
+              0xffff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff}), true, true}, // M521 (2^521-1)
 };
 
 BOOST_DATA_TEST_CASE(test_trivial_division_for_native, samples)
@@ -70,6 +84,17 @@ BOOST_DATA_TEST_CASE(test_trivial_division, samples)
     BOOST_TEST(primality::trivial_division(sample.num) == sample.is_prime_number);
 }
 
+static const sample_t trivial_division_samples[] = {
+    {Integer({0x4c00000393, 0x1}), false}, // 4294967311*4294967357, factors over 2^32
+    {Integer({0x7fff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff}), true}, // M127
+    {Integer({0xffff'ffff'ffff'ffc5, 0xffff'ffff'ffff'ffff}) * Integer({3}), false},
+};
+
+BOOST_DATA_TEST_CASE(test_trivial_division_over_block, trivial_division_samples)
+{
+    BOOST_TEST(primality::trivial_division(sample.num) == sample.is_prime_number);
+}
+
 BOOST_DATA_TEST_CASE(test_fermat_test, samples)
 {
     BOOST_TEST(primality::fermat_test(sample.num) == sample.is_prime_number);
@@ -80,4 +105,233 @@ BOOST_DATA_TEST_CASE(test_miller_rabin_test, samples)
     BOOST_TEST(primality::miller_rabin_test(sample.num) == sample.is_prime_number);
 }
 
+BOOST_DATA_TEST_CASE(test_fermat_test_with_small_factor_filter, samples)
+{
+    BOOST_TEST(primality::fermat_test(sample.num, true) == sample.is_prime_number);
+}
+
+BOOST_DATA_TEST_CASE(test_miller_rabin_test_with_small_factor_filter, samples)
+{
+    BOOST_TEST(primality::miller_rabin_test(sample.num, true) == sample.is_prime_number);
+}
+
+static struct small_factor_sample_t {
+    Integer n;
+    bool expected;
+
+    friend std::ostream& operator<<(std::ostream& os, const small_factor_sample_t& s) {
+        os << "n: " << s.n << ", expected: " << util::to_string(s.expected);
+        return os;
+    }
+} small_factor_samples[] = {
+    {Integer({1}), false},
+    {Integer({2}), false},
+    {Integer({4}), true},
+    {Integer({15}), true},                 // 3*5 in the same product
+    {Integer({16'381}), false},            // The largest prime less than SmallFactorLimit
+    {Integer({16'381 * 3}), true},
+    {Integer({16'411}), false},            // The smallest prime over SmallFactorLimit
+    {Integer({16'411 * 16'417}), false},   // No factor less than SmallFactorLimit
+    {Integer({0x7fff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff}), false}, // M127
+    {Integer({0xffff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff}), true},  // 2^128-1 (3*5*17*...)
+    {Integer({0, 16'381}), false},       // With a leading zero block
+};
+
+BOOST_DATA_TEST_CASE(test_has_small_factor, small_factor_samples)
+{
+    BOOST_TEST(primality::has_small_factor(sample.n) == sample.expected);
+}
+
+static struct miller_rabin_for_block_sample_t {
+    Integer::block_t n;
+    bool expected;
+
+    friend std::ostream& operator<<(std::ostream& os, const miller_rabin_for_block_sample_t& s) {
+        os << "n: " << s.n << ", expected: " << util::to_string(s.expected);
+        return os;
+    }
+} miller_rabin_for_block_samples[] = {
+    {0, false},
+    {1, false},
+    {2, true},
+    {3, true},
+    {4, false},
+    {325, false},
+    {3'215'031'751, false},                // Strong pseudoprime to bases 2, 3, 5 and 7
+    {3'825'123'056'546'413'051, false},    // Strong pseudoprime to bases 2 .. 31
+    {0xffff'ffff'ffff'ffc5, true},         // The largest prime less than 2^64
+    {0xffff'ffff'ffff'ffff, false},
+};
+
+BOOST_DATA_TEST_CASE(test_miller_rabin_test_for_block, miller_rabin_for_block_samples)
+{
+    BOOST_TEST(primality::miller_rabin_test(sample.n) == sample.expected);
+}
+
+BOOST_DATA_TEST_CASE(test_bpsw_test, samples)
+{
+    BOOST_TEST(primality::bpsw_test(sample.num) == sample.is_prime_number);
+}
+
+static struct jacobi_sample_t {
+    const std::int64_t a;
+    const Integer& n;
+    const int expected;
+
+    friend std::ostream& operator<<(std::ostream& os, const jacobi_sample_t& s) {
+        os << "a: " << s.a << ", n: " << s.n << ", expected: " << s.expected;
+        return os;
+    }
+} jacobi_samples[] = {
+    {5, Integer({3}), -1},
+    {-7, Integer({5}), -1},
+    {2, Integer({7}), 1},
+    {3, Integer({9}), 0},
+    {1001, Integer({9907}), -1},
+    {19, Integer({45}), 1},
+    {-1, Integer({7}), -1},
+    {-1, Integer({13}), 1},
+    {0, Integer({1}), 1},
+    {5, Integer({0x7fff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff}), -1},
+    {-11, Integer({0x7fff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff}), -1},
+};
+
+BOOST_DATA_TEST_CASE(test_jacobi_symbol, jacobi_samples)
+{
+    BOOST_TEST(primality::jacobi_symbol(sample.a, sample.n) == sample.expected);
+}
+
+static const std::size_t mersenne_prime_exponents[] = {
+    2, 3, 5, 7, 13, 17, 19, 31, 61, 89, 107, 127, 521, 607, 1279,
+};
+
+BOOST_AUTO_TEST_CASE(test_lucas_lehmer_test)
+{
+    const auto* begin = std::begin(mersenne_prime_exponents);
+    const auto* end = std::end(mersenne_prime_exponents);
+    for (std::size_t p = 0; p <= 1279; p++) {
+        BOOST_TEST_CONTEXT("p: " << p) {
+            BOOST_TEST(primality::lucas_lehmer_test(p) == (std::find(begin, end, p) != end));
+        }
+    }
+}
+
+static struct mersenne_exponent_sample_t {
+    const Integer& n;
+    const std::size_t expected; // 0 means that n is not a Mersenne number
+
+    friend std::ostream& operator<<(std::ostream& os, const mersenne_exponent_sample_t& s) {
+        os << "n: " << s.n;
+        return os;
+    }
+} mersenne_exponent_samples[] = {
+    {Integer({0}), 0},
+    {Integer({1}), 1},
+    {Integer({2}), 0},
+    {Integer({7}), 3},
+    {Integer({0xffff'ffff'ffff'ffff}), 64},
+    {Integer({0xffff'ffff'ffff'fffe}), 0},
+    {Integer({0x7fff'ffff'ffff'ffff, 0xffff'ffff'ffff'ffff}), 127},
+    {Integer({0x7fff'ffff'ffff'ffff, 0xffff'ffff'7fff'ffff}), 0},
+};
+
+BOOST_DATA_TEST_CASE(test_get_mersenne_exponent, mersenne_exponent_samples)
+{
+    BOOST_TEST(primality::get_mersenne_exponent(sample.n).value_or(0) == sample.expected);
+}
+
+static struct proth_form_sample_t {
+    const Integer& n;
+    const bool is_proth;
+    const Integer::block_t k;
+    const std::size_t m;
+
+    friend std::ostream& operator<<(std::ostream& os, const proth_form_sample_t& s) {
+        os << "n: " << s.n;
+        return os;
+    }
+} proth_form_samples[] = {
+    {Integer({1}), false, 0, 0},
+    {Integer({2}), false, 0, 0},
+    {Integer({3}), true, 1, 1},
+    {Integer({7}), false, 0, 0},         // 3 * 2 + 1
+    {Integer({13}), true, 3, 2},
+    {Integer({97}), true, 3, 5},
+    {Integer({0x1'0000'0001}), true, 1, 32},
+    {Integer({1, 1}), true, 1, 64},      // 2^64 + 1
+    {Integer({1, 3}), false, 0, 0},      // 2^64 + 3
+    {Integer({3, 1}), true, 3, 64},
+    {Integer({0x5, 0x8000'0000'0000'0001}), true, 0xb, 63},
+    // k = 2^67 + 1 doesn't fit in a block
+    {Integer({0x4, 0, 0x8000'0000'0000'0001}), false, 0, 0},
+};
+
+BOOST_DATA_TEST_CASE(test_get_proth_form, proth_form_samples)
+{
+    const std::optional<primality::ProthForm> form = primality::get_proth_form(sample.n);
+    BOOST_REQUIRE(form.has_value() == sample.is_proth);
+    if (!form)
+        return;
+    BOOST_TEST(form->k == sample.k);
+    BOOST_TEST(form->m == sample.m);
+}
+
+BOOST_AUTO_TEST_CASE(test_proth_test)
+{
+    for (const Integer::block_t k: {1, 3, 5, 7, 9, 15, 27}) {
+        for (std::size_t m = 1; m <= 300; m++) {
+            if (m < Integer::BlockBits && (k >> m) != 0)
+                continue;
+            Integer n(Integer({k}) * Integer::pow2(m) + constant::One);
+            BOOST_TEST_CONTEXT("k: " << k << ", m: " << m) {
+                BOOST_TEST(primality::proth_test(n) == primality::bpsw_test(n));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_proth_test_for_known_numbers)
+{
+    // F4 = 2^16 + 1 is a prime and F5 = 2^32 + 1 = 641 * 6700417 is not.
+    BOOST_TEST(primality::proth_test(Integer({0x1'0001})));
+    BOOST_TEST(!primality::proth_test(Integer({0x1'0000'0001})));
+    // 3 * 2^189 + 1 is a prime.
+    BOOST_TEST(primality::proth_test(Integer({3}) * Integer::pow2(189) + constant::One));
+}
+
+BOOST_AUTO_TEST_CASE(test_proth_test_with_other_number)
+{
+    BOOST_CHECK_THROW(primality::proth_test(Integer({7})), std::invalid_argument);
+}
+
+BOOST_DATA_TEST_CASE(test_test_with_auto, samples)
+{
+    BOOST_TEST(primality::test(sample.num, primality::Algorithm::Auto) ==
+               sample.is_prime_number);
+}
+
+static const std::size_t num_threads_samples[] = {1, 2, 4};
+
+BOOST_DATA_TEST_CASE(test_test_many, num_threads_samples)
+{
+    std::vector<Integer> candidates;
+    std::vector<bool> expected;
+    for (const sample_t& s: samples) {
+        candidates.emplace_back(s.num);
+        expected.emplace_back(s.is_prime_number);
+    }
+    const primality::BatchResult result =
+      primality::test_many(candidates, primality::Algorithm::BpswTest, sample);
+    BOOST_TEST(result.is_prime == expected, boost::test_tools::per_element());
+    BOOST_TEST(result.num_threads == sample);
+    BOOST_TEST(result.get_throughput() > 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_test_many_with_no_candidate)
+{
+    const primality::BatchResult result =
+      primality::test_many({}, primality::Algorithm::MillerRabinTest);
+    BOOST_TEST(result.is_prime.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
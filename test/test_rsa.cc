@@ -1,7 +1,10 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
+#include <vector>
 #include "Integer.h"
 #include "sample_types.h"
+#include "constant.h"
+#include "util.h"
 #include "rsa.h"
 
 using namespace grill;
@@ -43,4 +46,205 @@ BOOST_DATA_TEST_CASE(compute, compute_samples)
     BOOST_TEST(rsa::compute(sample.priv_exp, modulus, encrypted) == n);
 }
 
+static const std::size_t num_threads_samples[] = {1, 2, 4};
+
+BOOST_DATA_TEST_CASE(generate_keys, num_threads_samples)
+{
+    const rsa::Keys keys = rsa::generate_keys(512, sample);
+    BOOST_TEST(keys.prime1 != keys.prime2);
+    BOOST_TEST(keys.modulus == keys.prime1 * keys.prime2);
+    const Integer n({0x1234'5678'9abc'def0});
+    const Integer encrypted = rsa::compute(keys.public_exponent, keys.modulus, n);
+    BOOST_TEST(rsa::compute(keys.private_exponent, keys.modulus, encrypted) == n);
+}
+
+BOOST_AUTO_TEST_CASE(generate_keys_with_crt_parameters)
+{
+    const rsa::Keys keys = rsa::generate_keys(512, 1);
+    const Integer& p = keys.prime1;
+    const Integer& q = keys.prime2;
+    BOOST_TEST(keys.exponent1 == keys.private_exponent % (p - constant::One));
+    BOOST_TEST(keys.exponent2 == keys.private_exponent % (q - constant::One));
+    BOOST_TEST((keys.coefficient * q) % p == constant::One);
+}
+
+// p=7, q=11, n=77, pub=13, priv=37, dP=37 mod 6=1, dQ=37 mod 10=7, qInv=11^-1 mod 7=2
+static const rsa::Keys small_keys = {
+    Integer({7}), Integer({11}), Integer({60}), Integer({77}), Integer({13}), Integer({37}),
+    Integer({1}), Integer({7}), Integer({2}),
+};
+
+BOOST_AUTO_TEST_CASE(compute_private)
+{
+    for (Integer::block_t c = 0; c < 77; c++) {
+        BOOST_TEST_CONTEXT("c: " << c) {
+            const Integer n({c});
+            BOOST_TEST(rsa::compute_private(small_keys, n) ==
+                       rsa::compute(small_keys.private_exponent, small_keys.modulus, n));
+        }
+    }
+}
+
+BOOST_DATA_TEST_CASE(compute_private_with_generated_keys, num_threads_samples)
+{
+    const rsa::Keys keys = rsa::generate_keys(1024, sample);
+    const Integer n = util::get_random(1000);
+    const Integer expected = rsa::compute(keys.private_exponent, keys.modulus, n);
+    BOOST_TEST(rsa::compute_private(keys, n) == expected);
+    BOOST_TEST(rsa::compute(keys.public_exponent, keys.modulus, expected) == n);
+}
+
+// p=11, q=13, r=7, n=1001, pub=7, priv=103, dP=3, dQ=7, qInv=6, d3=1, t3=(11*13)^-1 mod 7=5
+static const rsa::Keys small_three_prime_keys = {
+    Integer({11}), Integer({13}), Integer({720}), Integer({1001}), Integer({7}), Integer({103}),
+    Integer({3}), Integer({7}), Integer({6}), {{Integer({7}), Integer({1}), Integer({5})}},
+};
+
+BOOST_AUTO_TEST_CASE(compute_private_with_three_primes)
+{
+    const rsa::Keys& keys = small_three_prime_keys;
+    for (Integer::block_t c = 0; c < 1001; c++) {
+        BOOST_TEST_CONTEXT("c: " << c) {
+            const Integer n({c});
+            BOOST_TEST(rsa::compute_private(keys, n) ==
+                       rsa::compute(keys.private_exponent, keys.modulus, n));
+        }
+    }
+}
+
+static const std::size_t num_primes_samples[] = {2, 3, 4};
+
+BOOST_DATA_TEST_CASE(generate_multi_prime_keys, num_primes_samples)
+{
+    const rsa::Keys keys = rsa::generate_keys(1024, 0, sample);
+    BOOST_TEST(keys.other_primes.size() == sample - 2);
+
+    Integer product = keys.prime1 * keys.prime2;
+    for (const rsa::OtherPrimeInfo& info: keys.other_primes) {
+        const Integer& r = info.prime;
+        BOOST_TEST(info.exponent == keys.private_exponent % (r - constant::One));
+        BOOST_TEST((info.coefficient * product) % r == constant::One);
+        product *= r;
+    }
+    BOOST_TEST(keys.modulus == product);
+
+    const Integer n = util::get_random(900);
+    const Integer encrypted = rsa::compute(keys.public_exponent, keys.modulus, n);
+    BOOST_TEST(rsa::compute_private(keys, encrypted) == n);
+}
+
+BOOST_DATA_TEST_CASE(compute_private_with_wide_messages, num_primes_samples)
+{
+    const rsa::Keys keys = rsa::generate_keys(1024, 0, sample);
+    for (const std::size_t bits: {1000, 1100, 2100}) {
+        BOOST_TEST_CONTEXT("bits: " << bits) {
+            const Integer n = util::get_random(bits);
+            BOOST_TEST(rsa::compute_private(keys, n) ==
+                       rsa::compute(keys.private_exponent, keys.modulus, n));
+        }
+    }
+}
+
+struct key_size_sample_t {
+    const std::size_t bit_length;
+    const std::size_t num_primes;
+
+    friend std::ostream& operator<<(std::ostream& os, const key_size_sample_t& s) {
+        os << "bit_length: " << s.bit_length << ", num_primes: " << s.num_primes;
+        return os;
+    }
+};
+
+static const key_size_sample_t key_size_samples[] = {
+    {1024, 2}, {1025, 2}, {1024, 3}, {2048, 3}, {1000, 4},
+};
+
+BOOST_DATA_TEST_CASE(generate_keys_modulus_bit_length, key_size_samples)
+{
+    const rsa::Keys keys = rsa::generate_keys(sample.bit_length, 0, sample.num_primes);
+    const std::size_t prime_bits = sample.bit_length / sample.num_primes;
+    std::vector<const Integer*> primes = {&keys.prime1, &keys.prime2};
+    for (const rsa::OtherPrimeInfo& info: keys.other_primes)
+        primes.emplace_back(&info.prime);
+    std::size_t sum = 0;
+    for (const Integer* r: primes) {
+        const std::size_t bits = r->most_significant_active_bit();
+        BOOST_TEST((bits == prime_bits || bits == prime_bits + 1));
+        sum += bits;
+    }
+    BOOST_TEST(sum == sample.bit_length);
+    BOOST_TEST(keys.modulus.most_significant_active_bit() == static_cast<int>(sample.bit_length));
+}
+
+BOOST_AUTO_TEST_CASE(generate_keys_with_one_prime)
+{
+    BOOST_CHECK_THROW(rsa::generate_keys(1024, 0, 1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(generate_keys_with_short_bit_length)
+{
+    BOOST_CHECK_THROW(rsa::generate_keys(4, 0, 2), std::invalid_argument);
+    BOOST_CHECK_THROW(rsa::generate_keys(8, 0, 3), std::invalid_argument);
+    BOOST_CHECK_THROW(rsa::check_key_size(3 * rsa::MinPrimeBits - 1, 3), std::invalid_argument);
+    BOOST_CHECK_NO_THROW(rsa::check_key_size(3 * rsa::MinPrimeBits, 3));
+}
+
+struct batch_options_sample_t {
+    const std::size_t num_threads;
+    const std::size_t batch_size;
+    const std::size_t queue_size;
+
+    friend std::ostream& operator<<(std::ostream& os, const batch_options_sample_t& s) {
+        os << "num_threads: " << s.num_threads << ", batch_size: " << s.batch_size
+           << ", queue_size: " << s.queue_size;
+        return os;
+    }
+};
+
+static const batch_options_sample_t batch_options_samples[] = {
+    {1, 1, 1},
+    {1, 64, 0},
+    {2, 3, 1},
+    {4, 7, 2},
+    {4, 1000, 0},
+};
+
+BOOST_DATA_TEST_CASE(compute_batch, batch_options_samples)
+{
+    const rsa::BatchOptions options = {sample.num_threads, sample.batch_size, sample.queue_size};
+    const rsa::Keys& keys = small_three_prime_keys;
+    std::vector<Integer> messages;
+    for (Integer::block_t c = 0; c < 1001; c++)
+        messages.emplace_back(Integer({c}));
+
+    const std::vector<Integer> encrypted =
+      rsa::compute_batch(keys.public_exponent, keys.modulus, messages, options);
+    BOOST_REQUIRE(encrypted.size() == messages.size());
+    for (std::size_t i = 0; i < messages.size(); i++)
+        BOOST_TEST(encrypted[i] == rsa::compute(keys.public_exponent, keys.modulus, messages[i]));
+
+    const std::vector<Integer> decrypted = rsa::compute_private_batch(keys, encrypted, options);
+    BOOST_TEST(decrypted == messages, boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(compute_batch_with_generated_keys)
+{
+    const rsa::Keys keys = rsa::generate_keys(1024, 1);
+    std::vector<Integer> messages;
+    for (int i = 0; i < 20; i++)
+        messages.emplace_back(util::get_random(1000));
+    const std::vector<Integer> encrypted =
+      rsa::compute_batch(keys.public_exponent, keys.modulus, messages);
+    BOOST_TEST(rsa::compute_private_batch(keys, encrypted) == messages,
+               boost::test_tools::per_element());
+}
+
+BOOST_AUTO_TEST_CASE(compute_batch_with_zero_batch_size)
+{
+    const rsa::BatchOptions options = {1, 0, 0};
+    const std::vector<Integer> messages = {Integer({2})};
+    BOOST_CHECK_THROW(rsa::compute_batch(Integer({13}), Integer({77}), messages, options),
+                      std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
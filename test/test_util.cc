@@ -1,6 +1,7 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/test/data/test_case.hpp>
 #include "util.h"
+#include "primality.h"
 #include "sample_types.h"
 #include "constant.h"
 
@@ -36,6 +37,11 @@ static gcd_sample_t gcd_samples[] {
     {Integer({3}),  Integer({6}),  Integer({3})},
 
     {Integer({10}),  Integer({15}),  Integer({5})},
+
+    {constant::Zero, Integer({3}),  Integer({3})},
+    {Integer({3}),  constant::Zero, Integer({3})},
+    {Integer({192, 0}),  Integer({18, 0}),  Integer({6, 0})},
+    {Integer({0x1'0000'0001, 0}),  Integer({0xffff'ffff'ffff'ffff}),  Integer({0x1'0000'0001})},
 };
 
 BOOST_DATA_TEST_CASE(equal, gcd_samples)
@@ -128,4 +134,32 @@ BOOST_AUTO_TEST_CASE(get_random_prime)
     BOOST_TEST(n.most_significant_active_bit() <= 32);
 }
 
+static const std::size_t get_random_prime_bit_lengths[] = {3, 4, 8, 14, 15, 32, 64, 65, 512};
+
+BOOST_DATA_TEST_CASE(get_random_prime_is_prime, get_random_prime_bit_lengths)
+{
+    const Integer n = util::get_random_prime(sample);
+    BOOST_TEST(n.most_significant_active_bit() == static_cast<int>(sample));
+    BOOST_TEST(primality::miller_rabin_test(n));
+    if (sample <= 32)
+        BOOST_TEST(primality::trivial_division(n.ref_blocks()[0]));
+}
+
+static const std::size_t num_threads_samples[] = {1, 2, 4};
+
+BOOST_DATA_TEST_CASE(get_random_primes, num_threads_samples)
+{
+    const std::vector<Integer> primes = util::get_random_primes(256, 3, sample);
+    BOOST_TEST(primes.size() == 3);
+    for (const Integer& p: primes) {
+        BOOST_TEST(p.most_significant_active_bit() == 256);
+        BOOST_TEST(primality::bpsw_test(p));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(get_random_primes_with_no_prime)
+{
+    BOOST_TEST(util::get_random_primes(64, 0).empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -1,11 +1,15 @@
 #include <iostream>
+#include <fstream>
 #include <cstdlib>
+#include <vector>
 #include <unordered_map>
 #include "ArgParser.h"
 #include "Integer.h"
 #include "primality.h"
 #include "util.h"
 #include "constant.h"
+#include "PrimeSieve.h"
+#include "factorization.h"
 
 using namespace grill;
 using namespace Leaf;
@@ -14,13 +18,31 @@ enum class Algrorithm {
     TrivialDivision,
     FermatTest,
     MillerRabinTest,
+    BpswTest,
+    LucasLehmerTest,
+    ProthTest,
+    Auto,
     Unknown,
 };
 
+static const std::unordered_map<Algrorithm, primality::Algorithm> primality_algorithm_map = {
+    {Algrorithm::TrivialDivision, primality::Algorithm::TrivialDivision},
+    {Algrorithm::FermatTest, primality::Algorithm::FermatTest},
+    {Algrorithm::MillerRabinTest, primality::Algorithm::MillerRabinTest},
+    {Algrorithm::BpswTest, primality::Algorithm::BpswTest},
+    {Algrorithm::LucasLehmerTest, primality::Algorithm::LucasLehmerTest},
+    {Algrorithm::ProthTest, primality::Algorithm::ProthTest},
+    {Algrorithm::Auto, primality::Algorithm::Auto},
+};
+
 static const std::unordered_map<Algrorithm, std::string> Algrorithm_name_map = {
     {Algrorithm::TrivialDivision, "trivial_division"},
     {Algrorithm::FermatTest, "fermat_test"},
     {Algrorithm::MillerRabinTest, "miller_rabin_test"},
+    {Algrorithm::BpswTest, "bpsw_test"},
+    {Algrorithm::LucasLehmerTest, "lucas_lehmer_test"},
+    {Algrorithm::ProthTest, "proth_test"},
+    {Algrorithm::Auto, "auto"},
 };
 
 std::string to_string(const Algrorithm name) {
@@ -32,6 +54,13 @@ std::string to_string(const Algrorithm name) {
 struct OptionsDef {
     bool show_help = false;
     bool primitive = false;
+    bool small_factor_filter = false;
+    bool enumerate = false;
+    bool factorize = false;
+    std::string batch_path;
+    std::size_t num_threads = 0;
+    Integer::block_t range_from = 0;
+    Integer::block_t range_to = 0;
     Algrorithm test_algrorithm = Algrorithm::TrivialDivision;
     Integer num = constant::Two;
 };
@@ -40,6 +69,10 @@ static const std::unordered_map<std::string, Algrorithm> Algrorithm_map = {
     {"trivial_division", Algrorithm::TrivialDivision},
     {"fermat_test", Algrorithm::FermatTest},
     {"miller_rabin_test", Algrorithm::MillerRabinTest},
+    {"bpsw_test", Algrorithm::BpswTest},
+    {"lucas_lehmer_test", Algrorithm::LucasLehmerTest},
+    {"proth_test", Algrorithm::ProthTest},
+    {"auto", Algrorithm::Auto},
 };
 
 static Algrorithm parse_algrorithm(const std::string& name) {
@@ -56,10 +89,22 @@ static const std::unordered_map<Algrorithm, std::function<bool(const OptionsDef&
                                  : primality::trivial_division(options.num);
     }},
     {Algrorithm::FermatTest, [](const OptionsDef& options) {
-        return primality::fermat_test(options.num);
+        return primality::fermat_test(options.num, options.small_factor_filter);
     }},
     {Algrorithm::MillerRabinTest, [](const OptionsDef& options) {
-        return primality::miller_rabin_test(options.num);
+        return primality::miller_rabin_test(options.num, options.small_factor_filter);
+    }},
+    {Algrorithm::BpswTest, [](const OptionsDef& options) {
+        return primality::bpsw_test(options.num);
+    }},
+    {Algrorithm::LucasLehmerTest, [](const OptionsDef& options) {
+        return primality::test(options.num, primality::Algorithm::LucasLehmerTest);
+    }},
+    {Algrorithm::ProthTest, [](const OptionsDef& options) {
+        return primality::proth_test(options.num);
+    }},
+    {Algrorithm::Auto, [](const OptionsDef& options) {
+        return primality::test(options.num, primality::Algorithm::Auto);
     }},
 };
 
@@ -75,9 +120,82 @@ static void run(const OptionsDef& options) {
     std::cout << "is_prime : " << util::to_string(is_prime) << std::endl;
 }
 
+static void enumerate(const OptionsDef& options) {
+    for (const Integer::block_t p: PrimeSieve(options.range_from, options.range_to))
+        std::cout << p << std::endl;
+}
+
+static void factorize(const OptionsDef& options) {
+    std::cout << "Number   : " << options.num << std::endl;
+    std::cout << "Factors  :";
+    for (const Integer& p: factorization::factorize(options.num))
+        std::cout << " " << p;
+    std::cout << std::endl;
+}
+
+// The candidates are tested by chunks so that the results are shown while reading.
+static constexpr std::size_t BatchChunkSize = 4096;
+
+static int batch(const OptionsDef& options) {
+    std::ifstream file;
+    if (options.batch_path != "-") {
+        file.open(options.batch_path);
+        if (!file) {
+            std::cerr << "Failed to open: " << options.batch_path << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::istream& is = (options.batch_path == "-") ? std::cin : file;
+
+    const auto algorithm_it = primality_algorithm_map.find(options.test_algrorithm);
+    assert(algorithm_it != primality_algorithm_map.end());
+
+    std::size_t num_candidates = 0;
+    std::size_t num_primes = 0;
+    std::size_t num_threads = 0;
+    double elapsed = 0;
+    std::vector<Integer> candidates;
+    const auto test_candidates = [&] {
+        const primality::BatchResult result =
+          primality::test_many(candidates, algorithm_it->second, options.num_threads);
+        for (std::size_t i = 0; i < candidates.size(); i++) {
+            std::cout << candidates[i] << " " << util::to_string(result.is_prime[i]) << "\n";
+            num_primes += result.is_prime[i];
+        }
+        num_candidates += candidates.size();
+        num_threads = result.num_threads;
+        elapsed += result.elapsed;
+        candidates.clear();
+    };
+
+    std::string line;
+    while (std::getline(is, line)) {
+        if (line.empty())
+            continue;
+        candidates.emplace_back(util::to_Integer(line));
+        if (candidates.size() == BatchChunkSize)
+            test_candidates();
+    }
+    if (!candidates.empty())
+        test_candidates();
+    std::cout << std::flush;
+
+    std::cerr << "Algorithm : " << to_string(options.test_algrorithm) << std::endl;
+    std::cerr << "Candidates: " << num_candidates << std::endl;
+    std::cerr << "Primes    : " << num_primes << std::endl;
+    std::cerr << "Threads   : " << num_threads << std::endl;
+    std::cerr << "Elapsed   : " << elapsed << " s" << std::endl;
+    std::cerr << "Throughput: " << ((elapsed > 0) ? num_candidates / elapsed : 0)
+              << " candidates/s" << std::endl;
+    return EXIT_SUCCESS;
+}
+
 int main(int argc, char *argv[]) {
     ArgParser<OptionsDef> parser("prime-number", "utility for prime numbers",
-                                  "prime-number -n N [-p|--primitive]");
+                                  "prime-number -n N [-p|--primitive] [-f|--filter]\n"
+                                  "prime-number -n N -F\n"
+                                  "prime-number -b FILE [-a A] [-t THREADS]\n"
+                                  "prime-number -e FROM TO");
     parser.add({"-h", "--help"}, [](OptionsDef& opt, ...) {
         opt.show_help = true;
     }, "", "Show this help message.");
@@ -86,6 +204,10 @@ int main(int argc, char *argv[]) {
         opt.primitive = true;
     }, "", "Use the primitive number type instead of the Integer class.");
 
+    parser.add({"-f", "--filter"}, [](OptionsDef& opt, ...) {
+        opt.small_factor_filter = true;
+    }, "", "Reject a number with a small prime factor before fermat_test or miller_rabin_test.");
+
     parser.add({"-a", "--Algrorithm"}, [](OptionsDef& opt, ArgParser<OptionsDef>& parser) {
         if (!parser.hasNext()) {
             parser.error("-a: parameter is required");
@@ -98,7 +220,8 @@ int main(int argc, char *argv[]) {
             parser.error("Unknwon Algrorithm: " + Algrorithm_name);
             return;
         }
-    }, "A", "Algorithm (trivial_division, fermat_test, or miller_rabin_test)");
+    }, "A", "Algorithm (trivial_division, fermat_test, miller_rabin_test, bpsw_test, "
+          "lucas_lehmer_test, proth_test, or auto)");
 
     parser.add({"-n"}, [](OptionsDef& opt, ArgParser<OptionsDef>& parser) {
         if (!parser.hasNext()) {
@@ -108,6 +231,40 @@ int main(int argc, char *argv[]) {
         opt.num = util::to_Integer(parser.getNext());
     }, "N", "Number of execution times" );
 
+    parser.add({"-F", "--factorize"}, [](OptionsDef& opt, ...) {
+        opt.factorize = true;
+    }, "", "Factorize N by trial division and Pollard-Brent rho.");
+
+    parser.add({"-b", "--batch"}, [](OptionsDef& opt, ArgParser<OptionsDef>& parser) {
+        if (!parser.hasNext()) {
+            parser.error("-b: FILE is required");
+            return;
+        }
+        opt.batch_path = parser.getNext();
+    }, "FILE", "Test the numbers in FILE (one per line, - for stdin) in parallel.");
+
+    parser.add({"-t", "--threads"}, [](OptionsDef& opt, ArgParser<OptionsDef>& parser) {
+        if (!parser.hasNext()) {
+            parser.error("-t: parameter is required");
+            return;
+        }
+        opt.num_threads = util::to_uint(util::to_Integer(parser.getNext()));
+    }, "THREADS", "Number of threads for -b (default: hardware threads)");
+
+    parser.add({"-e", "--enumerate"}, [](OptionsDef& opt, ArgParser<OptionsDef>& parser) {
+        if (!parser.hasNext()) {
+            parser.error("-e: FROM is required");
+            return;
+        }
+        opt.range_from = util::to_uint(util::to_Integer(parser.getNext()));
+        if (!parser.hasNext()) {
+            parser.error("-e: TO is required");
+            return;
+        }
+        opt.range_to = util::to_uint(util::to_Integer(parser.getNext()));
+        opt.enumerate = true;
+    }, "FROM TO", "Enumerate the primes in [FROM, TO).");
+
     if (!parser.parse(argc, argv)) {
         std::cout << parser.getErrorMessage() << std::endl;
         std::cout << std::endl;
@@ -121,7 +278,15 @@ int main(int argc, char *argv[]) {
         return EXIT_SUCCESS;
     }
 
-    run(options);
+    if (!options.batch_path.empty())
+        return batch(options);
+
+    if (options.enumerate)
+        enumerate(options);
+    else if (options.factorize)
+        factorize(options);
+    else
+        run(options);
 
     return EXIT_SUCCESS;
 }
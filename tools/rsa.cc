@@ -1,6 +1,8 @@
 #include <cstdlib>
 #include <sstream>
 #include <memory>
+#include <string>
+#include <vector>
 #include "ArgParser.h"
 #include "Integer.h"
 #include "constant.h"
@@ -17,15 +19,49 @@ struct Options {
     Integer modulus = constant::Two;
     Integer num = constant::Zero;
     std::size_t bit_length = 0;
+    std::size_t num_threads = 0;
+    std::size_t num_primes = 2;
+    bool stream = false;
+    rsa::BatchOptions batch_options;
 };
 
+// The numbers are computed by chunks so that the results are written while reading.
+static constexpr std::size_t StreamChunkSize = 4096;
+
+static int stream(const Options& options, const Integer& exponent, const Integer& modulus) {
+    std::vector<Integer> messages;
+    const auto compute_messages = [&] {
+        const std::vector<Integer> results =
+          rsa::compute_batch(exponent, modulus, messages, options.batch_options);
+        for (const Integer& result: results)
+            std::cout << result << "\n";
+        messages.clear();
+    };
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty())
+            continue;
+        messages.emplace_back(util::to_Integer(line));
+        if (messages.size() == StreamChunkSize)
+            compute_messages();
+    }
+    if (!messages.empty())
+        compute_messages();
+    std::cout << std::flush;
+    return EXIT_SUCCESS;
+}
+
 static int run(const Options& options) {
     std::unique_ptr<rsa::Keys> keys;
     if (options.generate_key)
-        keys = std::make_unique<rsa::Keys>(rsa::generate_keys(options.bit_length));
+        keys = std::make_unique<rsa::Keys>(
+          rsa::generate_keys(options.bit_length, options.num_threads, options.num_primes));
 
     const Integer& exponent = options.generate_key ? keys->public_exponent : options.exponent;
     const Integer& modulus = options.generate_key ? keys->modulus : options.modulus;
+    if (options.stream)
+        return stream(options, exponent, modulus);
 
     std::cout << "Exponent : " << exponent << std::endl;
     std::cout << "Modulo   : " << modulus << std::endl;
@@ -34,17 +70,22 @@ static int run(const Options& options) {
     if (options.generate_key) {
         std::cout << "Prime1   : " << keys->prime1 << std::endl;
         std::cout << "Prime2   : " << keys->prime2 << std::endl;
+        for (std::size_t i = 0; i < keys->other_primes.size(); i++)
+            std::cout << "Prime" << i + 3 << "   : " << keys->other_primes[i].prime << std::endl;
         std::cout << "Priv.exp.: " << keys->private_exponent << std::endl;
     }
 
     const Integer result = rsa::compute(exponent, modulus, options.num);
     std::cout << "Result   : " << result << std::endl;
+    if (options.generate_key)
+        std::cout << "Decrypted: " << rsa::compute_private(*keys, result) << std::endl;
 
     return EXIT_SUCCESS;
 }
 
 static const char* const HELP_LINE =
-  "rsa [-h|--help] [-e|--exponent E] [-m|--modulus M] [-g|--generate-key L] -n N]";
+  "rsa [-h|--help] [-e|--exponent E] [-m|--modulus M] [-g|--generate-key L [-k|--primes K]] [-t|--threads T] "
+  "[-n N | -s|--stream [--batch-size B] [--queue-size Q]]";
 
 int main(int argc, char* argv[]) {
     ArgParser<Options> parser("rsa", "utility for RSA", HELP_LINE);
@@ -74,7 +115,7 @@ int main(int argc, char* argv[]) {
             parser.error("-L: bit length parameter is required");
             return;
         }
-        opt.bit_length = std::stoul(parser.getNext());
+        opt.bit_length = util::to_uint(util::to_Integer(parser.getNext()));
         if ((opt.bit_length % Integer::BlockBits) != 0) {
             std::stringstream ss;
             ss << "Bit length parameter must be a multiple of " << Integer::BlockBits;
@@ -85,6 +126,51 @@ int main(int argc, char* argv[]) {
     }, "L", "Generate a key pair whose bit length is L. When this option is given, "
             "-m option is ignored.");
 
+    parser.add({"-k", "--primes"}, [](Options& opt, ArgParser<Options>& parser) {
+        if (!parser.hasNext()) {
+            parser.error("-k: parameter is required");
+            return;
+        }
+        opt.num_primes = util::to_uint(util::to_Integer(parser.getNext()));
+        if (opt.num_primes < 2) {
+            parser.error("The number of primes must be greater than or equal to 2");
+            return;
+        }
+    }, "K", "The number of primes for -g. More than 2 makes a multi-prime key (default: 2)");
+
+    parser.add({"-t", "--threads"}, [](Options& opt, ArgParser<Options>& parser) {
+        if (!parser.hasNext()) {
+            parser.error("-t: parameter is required");
+            return;
+        }
+        opt.num_threads = util::to_uint(util::to_Integer(parser.getNext()));
+        opt.batch_options.num_threads = opt.num_threads;
+    }, "T", "The number of threads for -g and -s (default: hardware threads)");
+
+    parser.add({"-s", "--stream"}, [](Options& opt, ...) {
+        opt.stream = true;
+    }, "", "Read numbers from stdin (one per line) and write the results to stdout in order.");
+
+    parser.add({"--batch-size"}, [](Options& opt, ArgParser<Options>& parser) {
+        if (!parser.hasNext()) {
+            parser.error("--batch-size: parameter is required");
+            return;
+        }
+        opt.batch_options.batch_size = util::to_uint(util::to_Integer(parser.getNext()));
+        if (opt.batch_options.batch_size == 0) {
+            parser.error("The batch size must be greater than 0");
+            return;
+        }
+    }, "B", "The number of numbers in a task for -s");
+
+    parser.add({"--queue-size"}, [](Options& opt, ArgParser<Options>& parser) {
+        if (!parser.hasNext()) {
+            parser.error("--queue-size: parameter is required");
+            return;
+        }
+        opt.batch_options.queue_size = util::to_uint(util::to_Integer(parser.getNext()));
+    }, "Q", "The maximum number of queued tasks for -s (default: twice the threads)");
+
     parser.add({"-n"}, [](Options& opt, ArgParser<Options>& parser) {
         if (!parser.hasNext()) {
             parser.error("-n: parameter is required");